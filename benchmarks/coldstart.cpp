@@ -0,0 +1,86 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <functional>
+#include <vector>
+#include <string>
+
+extern "C" {
+#include <unistd.h>
+#include <sys/wait.h>
+}
+
+#include <benchmark/benchmark.h>
+
+#include "cipher.h"
+#include "gpgcrypto.h"
+
+namespace dpaste {
+namespace bench {
+
+/*
+ * Cold start costs are only paid once per process, so each iteration forks a
+ * fresh child which runs the startup step and exits. BM_ColdStart_Fork gives
+ * the fork/wait overhead to subtract from the other cases.
+ */
+static void cold_start(benchmark::State& state, const std::function<void()>& step) {
+    for (auto _ : state) {
+        auto pid = fork();
+        if (pid == 0) {
+            try {
+                step();
+            } catch (...) {
+                _exit(1);
+            }
+            _exit(0);
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        if (not WIFEXITED(status) or WEXITSTATUS(status) != 0) {
+            state.SkipWithError("child failed");
+            break;
+        }
+    }
+}
+
+static void BM_ColdStart_Fork(benchmark::State& state) {
+    cold_start(state, [](){});
+}
+BENCHMARK(BM_ColdStart_Fork)->Unit(benchmark::kMillisecond);
+
+/* What a plain or AES get pays before decrypting: guessing the cipher. */
+static void BM_ColdStart_CipherGuess(benchmark::State& state) {
+    const std::vector<uint8_t> data {'s', 'o', 'm', 'e', ' ', 'd', 'a', 't', 'a'};
+    cold_start(state, [&]() {
+        benchmark::DoNotOptimize(crypto::Cipher::get(data, "0123456789ABCDEF"));
+    });
+}
+BENCHMARK(BM_ColdStart_CipherGuess)->Unit(benchmark::kMillisecond);
+
+/* What every invocation used to pay, and what GPG invocations still pay. */
+static void BM_ColdStart_GPGInit(benchmark::State& state) {
+    cold_start(state, []() { crypto::GPG::init(); });
+}
+BENCHMARK(BM_ColdStart_GPGInit)->Unit(benchmark::kMillisecond);
+
+} /* bench */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
@@ -0,0 +1,57 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace dpaste {
+namespace bench {
+
+/**
+ * Payload sizes shared by the cases processing paste data, from a one byte
+ * paste to one split in many parts. Use with Benchmark::Apply().
+ */
+inline void payload_sizes(benchmark::internal::Benchmark* b) {
+    for (int64_t size : {1, 64, 1024, 16*1024, 64*1024, 4*1024*1024})
+        b->Arg(size);
+}
+
+/**
+ * Deterministic pseudo-random payload, so that runs are comparable.
+ *
+ * @param len  The size of the payload.
+ */
+inline std::vector<uint8_t> random_payload(size_t len) {
+    std::mt19937 rd;
+    std::vector<uint8_t> data (len);
+    std::generate(data.begin(), data.end(), std::ref(rd));
+    return data;
+}
+
+} /* bench */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
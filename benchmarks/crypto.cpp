@@ -0,0 +1,115 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "cipher.h"
+#include "aescrypto.h"
+#include "gpgcrypto.h"
+#include "corpus.h"
+#include "keyring.h"
+
+namespace dpaste {
+namespace bench {
+
+/*
+ * AES cases encrypt with a key derived once, like parts of a large paste do
+ * (see Packet::salt), so that key stretching does not hide the cipher cost.
+ */
+static std::shared_ptr<crypto::Parameters> aes_key() {
+    static std::vector<uint8_t> salt;
+    static const auto key = crypto::AES::deriveKey("0123456789ABCDEF", salt);
+    auto p = std::make_shared<crypto::Parameters>();
+    p->emplace<crypto::AESParameters>(key);
+    return p;
+}
+
+static void BM_AES_Encrypt(benchmark::State& state) {
+    crypto::AES aes;
+    const auto data = random_payload(state.range(0));
+    const auto key = aes_key();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(aes.processPlainText(data, std::make_shared<crypto::Parameters>(*key)));
+    state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_AES_Encrypt)->Apply(payload_sizes);
+
+static void BM_AES_Decrypt(benchmark::State& state) {
+    crypto::AES aes;
+    const auto key = aes_key();
+    const auto cipher_text = aes.processPlainText(random_payload(state.range(0)),
+                                                  std::make_shared<crypto::Parameters>(*key));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(aes.processCipherText(cipher_text, std::make_shared<crypto::Parameters>(*key)));
+    state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_AES_Decrypt)->Apply(payload_sizes);
+
+static void BM_GPG_Sign(benchmark::State& state) {
+    const auto& key = tests::TestKeyring::key();
+    if (key.empty()) {
+        state.SkipWithError("could not generate the test key");
+        return;
+    }
+    crypto::GPG gpg {key};
+    const auto data = random_payload(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(gpg.sign(data, true));
+    state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_GPG_Sign)->Apply(payload_sizes)->Unit(benchmark::kMicrosecond);
+
+static void BM_GPG_Verify(benchmark::State& state) {
+    const auto& key = tests::TestKeyring::key();
+    if (key.empty()) {
+        state.SkipWithError("could not generate the test key");
+        return;
+    }
+    crypto::GPG gpg {key};
+    const auto data = random_payload(state.range(0));
+    const auto signature = gpg.sign(data, true).first;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(gpg.verify(signature, data, true));
+    state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_GPG_Verify)->Apply(payload_sizes)->Unit(benchmark::kMicrosecond);
+
+static void BM_GPG_Encrypt(benchmark::State& state) {
+    const auto& key = tests::TestKeyring::key();
+    if (key.empty()) {
+        state.SkipWithError("could not generate the test key");
+        return;
+    }
+    crypto::GPG gpg {key};
+    const auto data = random_payload(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(gpg.encrypt({key}, data));
+    state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_GPG_Encrypt)->Apply(payload_sizes)->Unit(benchmark::kMicrosecond);
+
+} /* bench */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
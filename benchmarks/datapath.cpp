@@ -0,0 +1,116 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <b64/encode.h>
+#include <opendht/infohash.h>
+
+#include "bin.h"
+#include "http_client.h"
+#include "corpus.h"
+
+namespace dpaste {
+namespace bench {
+
+class PirateBinBencher {
+public:
+    using Packet = Bin::Packet;
+
+    static std::vector<uint8_t> data_from_stream(std::stringstream&& input_stream) {
+        return Bin::data_from_stream(std::move(input_stream));
+    }
+    static std::string random_pin() { return Bin::random_pin(); }
+};
+
+static void BM_Packet_Serialize(benchmark::State& state) {
+    PirateBinBencher::Packet p;
+    p.data = random_payload(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(p.serialize());
+    state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_Packet_Serialize)->Apply(payload_sizes);
+
+static void BM_Packet_Deserialize(benchmark::State& state) {
+    PirateBinBencher::Packet p;
+    p.data = random_payload(state.range(0));
+    const auto buffer = p.serialize();
+    for (auto _ : state) {
+        PirateBinBencher::Packet q;
+        q.deserialize(buffer);
+        benchmark::DoNotOptimize(q.data.data());
+    }
+    state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_Packet_Deserialize)->Apply(payload_sizes);
+
+static void BM_DataFromStream(benchmark::State& state) {
+    const auto data = random_payload(state.range(0));
+    const std::string s {data.begin(), data.end()};
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::stringstream ss {s};
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(PirateBinBencher::data_from_stream(std::move(ss)));
+    }
+    state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_DataFromStream)->Apply(payload_sizes);
+
+/* The body of a proxy response holding one value (see HttpClient::get). */
+static void BM_HttpClient_Decode(benchmark::State& state) {
+    const auto data = random_payload(state.range(0));
+    std::istringstream iss {std::string {data.begin(), data.end()}};
+    std::ostringstream b64;
+    base64::encoder e;
+    e.encode(iss, b64);
+    /* libb64 wraps lines, which JSON strings may not hold */
+    auto encoded = b64.str();
+    encoded.erase(std::remove(encoded.begin(), encoded.end(), '\n'), encoded.end());
+    const auto response = "[{\"id\":\"1\",\"base64\":\"" + encoded + "\"}]";
+    for (auto _ : state)
+        benchmark::DoNotOptimize(HttpClient::decode(response));
+    state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_HttpClient_Decode)->Apply(payload_sizes);
+
+static void BM_RandomPin(benchmark::State& state) {
+    for (auto _ : state)
+        benchmark::DoNotOptimize(PirateBinBencher::random_pin());
+}
+BENCHMARK(BM_RandomPin);
+
+/* Location codes are hashed once per request. */
+static void BM_InfoHash_Get(benchmark::State& state) {
+    const auto code = PirateBinBencher::random_pin();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(dht::InfoHash::get(code));
+}
+BENCHMARK(BM_InfoHash_Get);
+
+} /* bench */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
@@ -0,0 +1,88 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bin.h"
+#include "cluster.h"
+#include "proxy.h"
+#include "corpus.h"
+
+namespace dpaste {
+namespace bench {
+
+/*
+ * Paste and get back through a DHT cluster of DEFAULT_SIZE nodes on the
+ * loopback interface (see tests::Cluster): the whole data path but the network.
+ */
+static void BM_Bin_PasteGet(benchmark::State& state) {
+    Bin bin {tests::Cluster::shared().options()};
+    const auto data = random_payload(state.range(0));
+    for (auto _ : state) {
+        auto code = bin.paste(std::vector<uint8_t> {data}, {});
+        auto got = bin.get(std::move(code));
+        if (not got.first or got.second.size() != data.size()) {
+            state.SkipWithError("paste not found");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_Bin_PasteGet)->Arg(1)->Arg(64*1024)->Arg(1024*1024)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/*
+ * Get through the HTTP proxy stand-in (see tests::Proxy), given the fault of
+ * the proxy: none, errors, truncated responses or a latency of 600ms (twice
+ * Bin::NODE_HEDGE_DELAY). On faults, the time to fall back to the DHT node is
+ * measured.
+ */
+static void BM_Bin_Get_ProxyFault(benchmark::State& state) {
+    using namespace std::literals::chrono_literals;
+    tests::Proxy proxy {tests::Cluster::shared().bootstrap()};
+    auto options = tests::Cluster::shared().options();
+    options["port"] = std::to_string(proxy.port());
+    Bin bin {options};
+    const auto data = random_payload(1024);
+    const auto code = bin.paste(std::vector<uint8_t> {data}, {});
+
+    tests::Proxy::Faults faults;
+    switch (state.range(0)) {
+        case 1: faults.status = 500; break;
+        case 2: faults.truncate = true; break;
+        case 3: faults.latency = 600ms; break;
+    }
+    proxy.set_faults(faults);
+    for (auto _ : state) {
+        auto got = bin.get(std::string {code});
+        if (not got.first) {
+            state.SkipWithError("paste not found");
+            break;
+        }
+    }
+}
+BENCHMARK(BM_Bin_Get_ProxyFault)->DenseRange(0, 3)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} /* bench */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
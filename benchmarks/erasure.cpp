@@ -0,0 +1,112 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "erasure.h"
+
+namespace dpaste {
+namespace bench {
+
+static const constexpr size_t STRIPE {16};
+static const constexpr size_t PART {40*1024};
+
+static std::vector<std::vector<uint8_t>> random_shards(size_t n, size_t len) {
+    std::mt19937 rd;
+    std::vector<std::vector<uint8_t>> shards (n, std::vector<uint8_t>(len));
+    for (auto& s : shards)
+        std::generate(s.begin(), s.end(), std::ref(rd));
+    return shards;
+}
+
+static void BM_ReedSolomon_Encode(benchmark::State& state) {
+    const size_t m = state.range(0);
+    ReedSolomon rs {STRIPE, m};
+    auto data = random_shards(STRIPE, PART);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(rs.encode(data));
+    state.SetBytesProcessed(state.iterations()*STRIPE*PART);
+}
+BENCHMARK(BM_ReedSolomon_Encode)->Arg(2)->Arg(4)->Arg(8);
+
+/* worst case: as many data parts missing as there are parity parts */
+static void BM_ReedSolomon_Reconstruct(benchmark::State& state) {
+    const size_t m = state.range(0);
+    ReedSolomon rs {STRIPE, m};
+    auto shards = random_shards(STRIPE, PART);
+    auto parity = rs.encode(shards);
+    shards.insert(shards.end(), parity.begin(), parity.end());
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto s = shards;
+        for (size_t i = 0; i < m; ++i)
+            s[i*STRIPE/m].clear();
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(rs.reconstruct(s));
+    }
+    state.SetBytesProcessed(state.iterations()*STRIPE*PART);
+}
+BENCHMARK(BM_ReedSolomon_Reconstruct)->Arg(2)->Arg(4)->Arg(8);
+
+/*
+ * Tail latency of fetching one stripe given a model of value lookups:
+ * log-normal latency (median 50ms) and a 2% chance that a value is missing,
+ * in which case the lookup only fails after a 2s search timeout and is tried
+ * again. Without parity (m=0) the stripe waits for its slowest part; with m
+ * parity parts it completes with the k-th fastest of k+m lookups.
+ */
+static void BM_StripeFetchLatency(benchmark::State& state) {
+    const size_t m = state.range(0);
+    static const constexpr size_t SAMPLES {10000};
+    std::mt19937_64 rd;
+    std::lognormal_distribution<double> latency {std::log(50.), .5};
+    std::bernoulli_distribution dropped {.02};
+    auto lookup = [&]() {
+        double t = 0;
+        while (dropped(rd))
+            t += 2000;
+        return t + latency(rd);
+    };
+
+    std::vector<double> stripes (SAMPLES);
+    std::vector<double> lookups (STRIPE+m);
+    for (auto _ : state) {
+        for (auto& s : stripes) {
+            std::generate(lookups.begin(), lookups.end(), lookup);
+            std::nth_element(lookups.begin(), lookups.begin()+STRIPE-1, lookups.end());
+            s = lookups[STRIPE-1];
+        }
+        std::sort(stripes.begin(), stripes.end());
+        benchmark::DoNotOptimize(stripes.data());
+    }
+    state.counters["p50_ms"] = stripes[SAMPLES/2];
+    state.counters["p99_ms"] = stripes[SAMPLES*99/100];
+    state.counters["p999_ms"] = stripes[SAMPLES*999/1000];
+}
+BENCHMARK(BM_StripeFetchLatency)->Arg(0)->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond);
+
+} /* bench */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
@@ -0,0 +1,408 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dpaste-load: concurrent clients paste and get through Bin against a DHT
+ * cluster on the loopback interface (see tests::Cluster), optionally behind
+ * the HTTP proxy stand-in (see tests::Proxy). The throughput and latency
+ * percentiles of each kind of operation are reported as JSON.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <getopt.h>
+}
+
+#include <nlohmann/json.hpp>
+
+#include "bin.h"
+#include "cipher.h"
+#include "cluster.h"
+#include "proxy.h"
+#include "keyring.h"
+
+namespace dpaste {
+namespace bench {
+
+template <typename T>
+using Weighted = std::vector<std::pair<T, unsigned>>;
+
+struct LoadArgs {
+    bool fail {false};
+    bool help {false};
+    unsigned clients {8};
+    std::chrono::seconds duration {10};
+    size_t nodes {tests::Cluster::DEFAULT_SIZE};
+    bool proxy {false};
+    Weighted<std::string> operations {{"paste", 1}, {"get", 1}};
+    Weighted<std::string> schemes {{"plain", 1}};
+    Weighted<size_t> sizes {{1024, 1}};
+    unsigned seed {0};
+    std::string output;
+};
+
+/* 64K, 4M, 1k... */
+static bool parse_size(const std::string& s, size_t& size) {
+    char* end;
+    size = std::strtoull(s.c_str(), &end, 10);
+    if (end == s.c_str())
+        return false;
+    switch (*end) {
+        case 'k': case 'K': size *= 1024; ++end; break;
+        case 'm': case 'M': size *= 1024*1024; ++end; break;
+    }
+    return *end == '\0';
+}
+
+/*
+ * NAME[=WEIGHT][,NAME[=WEIGHT]...], a weight of 1 if not given.
+ */
+template <typename T, typename Parse>
+static bool parse_weighted(const std::string& s, Weighted<T>& out, Parse parse) {
+    out.clear();
+    std::istringstream ss {s};
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        const auto eq = item.find('=');
+        T value;
+        if (not parse(item.substr(0, eq), value))
+            return false;
+        unsigned weight {1};
+        if (eq != std::string::npos) {
+            char* end;
+            weight = std::strtoul(item.c_str()+eq+1, &end, 10);
+            if (*end != '\0' or end == item.c_str()+eq+1)
+                return false;
+        }
+        out.emplace_back(std::move(value), weight);
+    }
+    return not out.empty();
+}
+
+static bool parse_name(const std::vector<std::string>& names, const std::string& s, std::string& name) {
+    name = s;
+    return std::find(names.begin(), names.end(), s) != names.end();
+}
+
+static const constexpr struct option long_options[] = {
+   {"help",       no_argument,       nullptr, 'h'},
+   {"clients",    required_argument, nullptr, 'c'},
+   {"duration",   required_argument, nullptr, 'd'},
+   {"nodes",      required_argument, nullptr, 'n'},
+   {"proxy",      no_argument,       nullptr, 'p'},
+   {"operations", required_argument, nullptr, 'O'},
+   {"schemes",    required_argument, nullptr, 'S'},
+   {"sizes",      required_argument, nullptr, 's'},
+   {"seed",       required_argument, nullptr, 'r'},
+   {"output",     required_argument, nullptr, 'o'},
+   {nullptr,      0,                 nullptr,  0 }
+};
+
+static LoadArgs parse_args(int argc, char *argv[]) {
+    LoadArgs la;
+    la.seed = std::random_device {}();
+    int opt;
+    while ((opt = getopt_long(argc, argv, "hc:d:n:ps:o:", long_options, nullptr)) != -1) {
+        bool ok {true};
+        switch (opt) {
+        case 'h':
+            la.help = true;
+            break;
+        case 'c':
+            la.clients = std::strtoul(optarg, nullptr, 10);
+            ok = la.clients > 0;
+            break;
+        case 'd':
+            la.duration = std::chrono::seconds {std::strtoul(optarg, nullptr, 10)};
+            ok = la.duration.count() > 0;
+            break;
+        case 'n':
+            la.nodes = std::strtoul(optarg, nullptr, 10);
+            ok = la.nodes > 0;
+            break;
+        case 'p':
+            la.proxy = true;
+            break;
+        case 'O':
+            ok = parse_weighted(optarg, la.operations, [](const std::string& s, std::string& name) {
+                return parse_name({"paste", "get"}, s, name);
+            });
+            break;
+        case 'S':
+            ok = parse_weighted(optarg, la.schemes, [](const std::string& s, std::string& name) {
+                return parse_name({"plain", "aes", "gpg"}, s, name);
+            });
+            break;
+        case 's':
+            ok = parse_weighted(optarg, la.sizes, parse_size);
+            break;
+        case 'r':
+            la.seed = std::strtoul(optarg, nullptr, 10);
+            break;
+        case 'o':
+            la.output = std::string(optarg);
+            break;
+        default:
+            ok = false;
+        }
+        if (not ok) {
+            if (optarg)
+                std::cerr << "Bad value: " << optarg << " (see --help)" << std::endl;
+            la.fail = true;
+            return la;
+        }
+    }
+    return la;
+}
+
+static void print_help() {
+    std::cout << "dpaste-load -- Drive concurrent pastes and gets against a local DHT cluster." << std::endl
+              << std::endl;
+    std::cout << "OPTIONS" << std::endl
+              << "    -c|--clients {n}         Number of concurrent clients, each with a Bin of its own (8)." << std::endl
+              << "    -d|--duration {s}        Duration of the run in seconds (10)." << std::endl
+              << "    -n|--nodes {n}           Number of nodes of the DHT cluster (4)." << std::endl
+              << "    -p|--proxy               Go through the HTTP proxy stand-in before the DHT node." << std::endl
+              << "    --operations {mix}       Weighted mix of operations (paste=1,get=1)." << std::endl
+              << "    --schemes {mix}          Weighted mix of pasted schemes: plain, aes or gpg (plain=1)." << std::endl
+              << "    -s|--sizes {mix}         Weighted mix of pasted sizes, with K or M suffixes (1K=1)." << std::endl
+              << "    --seed {n}               Seed of the clients' choices." << std::endl
+              << "    -o|--output {file}       Write the JSON report to {file} instead of the standard output."
+              << std::endl << std::endl;
+    std::cout << "A mix is NAME[=WEIGHT][,NAME[=WEIGHT]...], e.g. --sizes 1K=8,64K=2,4M=1. Gets are made on" << std::endl
+              << "codes pasted during the run, so their schemes and sizes follow those of the pastes." << std::endl;
+}
+
+/* latencies and outcomes of one kind of operation (e.g. "get/aes") */
+struct Samples {
+    std::vector<double> ms;
+    size_t bytes {0};
+    size_t errors {0};
+
+    void merge(Samples&& o) {
+        ms.insert(ms.end(), o.ms.begin(), o.ms.end());
+        bytes += o.bytes;
+        errors += o.errors;
+    }
+};
+
+struct Pasted {
+    std::string code;
+    std::string scheme;
+    size_t size;
+};
+
+template <typename T>
+static std::discrete_distribution<size_t> weights_of(const Weighted<T>& w) {
+    std::vector<unsigned> weights;
+    for (const auto& i : w)
+        weights.push_back(i.second);
+    return {weights.begin(), weights.end()};
+}
+
+static std::unique_ptr<crypto::Parameters> params_of(const std::string& scheme, const std::string& key) {
+    if (scheme == "plain")
+        return {};
+    auto params = std::make_unique<crypto::Parameters>();
+    if (scheme == "aes")
+        params->emplace<crypto::AESParameters>();
+    else
+        params->emplace<crypto::GPGParameters>(std::vector<std::string> {key}, false, false);
+    return params;
+}
+
+/* nearest rank */
+static double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty())
+        return 0;
+    const auto rank = static_cast<size_t>(std::ceil(q*sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1))-1];
+}
+
+static int run(const LoadArgs& la) {
+    using clock = std::chrono::steady_clock;
+    crypto::Cipher::init();
+
+    std::string key;
+    if (std::find_if(la.schemes.begin(), la.schemes.end(), [](const std::pair<std::string, unsigned>& s) {
+                return s.first == "gpg"; }) != la.schemes.end()) {
+        key = tests::TestKeyring::key();
+        if (key.empty()) {
+            std::cerr << "Could not generate a GPG key with gpg(1)." << std::endl;
+            return 1;
+        }
+    }
+
+    tests::Cluster cluster {la.nodes};
+    std::unique_ptr<tests::Proxy> proxy;
+    auto options = cluster.options();
+    options["pgp_key_id"] = key;
+    if (la.proxy) {
+        proxy = std::make_unique<tests::Proxy>(cluster.bootstrap());
+        options["port"] = std::to_string(proxy->port());
+    }
+
+    size_t max_size {0};
+    for (const auto& s : la.sizes)
+        max_size = std::max(max_size, s.first);
+    std::vector<uint8_t> payload (max_size);
+    {
+        std::mt19937 rd {la.seed};
+        std::generate(payload.begin(), payload.end(), std::ref(rd));
+    }
+
+    std::mutex mtx;
+    std::vector<Pasted> pasted;
+    std::map<std::string, Samples> samples;
+
+    const auto start = clock::now();
+    const auto deadline = start+la.duration;
+    std::vector<std::thread> clients;
+    for (unsigned c = 0; c < la.clients; ++c) {
+        clients.emplace_back([&, c]() {
+            Bin bin {options};
+            std::mt19937_64 rd {la.seed+c};
+            auto operation = weights_of(la.operations);
+            auto scheme = weights_of(la.schemes);
+            auto size = weights_of(la.sizes);
+            std::map<std::string, Samples> mine;
+
+            while (clock::now() < deadline) {
+                bool get = la.operations[operation(rd)].first == "get";
+                Pasted p;
+                {
+                    std::lock_guard<std::mutex> lk(mtx);
+                    if (get and pasted.empty())
+                        get = false;
+                    if (get)
+                        p = pasted[std::uniform_int_distribution<size_t> {0, pasted.size()-1}(rd)];
+                }
+
+                bool ok;
+                clock::time_point t0;
+                if (get) {
+                    t0 = clock::now();
+                    auto got = bin.get(std::string {p.code});
+                    ok = got.first and got.second.size() == p.size;
+                } else {
+                    p.scheme = la.schemes[scheme(rd)].first;
+                    p.size = la.sizes[size(rd)].first;
+                    std::vector<uint8_t> data {payload.begin(), payload.begin()+p.size};
+                    auto params = params_of(p.scheme, key);
+                    t0 = clock::now();
+                    p.code = bin.paste(std::move(data), std::move(params));
+                    ok = not p.code.empty();
+                }
+                const std::chrono::duration<double, std::milli> latency {clock::now()-t0};
+
+                auto& s = mine[(get ? "get/" : "paste/")+p.scheme];
+                s.ms.push_back(latency.count());
+                if (ok)
+                    s.bytes += p.size;
+                else
+                    ++s.errors;
+                if (ok and not get) {
+                    std::lock_guard<std::mutex> lk(mtx);
+                    pasted.emplace_back(std::move(p));
+                }
+            }
+
+            std::lock_guard<std::mutex> lk(mtx);
+            for (auto& m : mine)
+                samples[m.first].merge(std::move(m.second));
+        });
+    }
+    for (auto& t : clients)
+        t.join();
+    const std::chrono::duration<double> elapsed {clock::now()-start};
+
+    auto j = nlohmann::json::object();
+    j["clients"] = la.clients;
+    j["nodes"] = la.nodes;
+    j["proxy"] = la.proxy;
+    j["seed"] = la.seed;
+    j["duration_s"] = elapsed.count();
+    j["operations"] = nlohmann::json::array();
+    for (auto& s : samples) {
+        auto& ms = s.second.ms;
+        std::sort(ms.begin(), ms.end());
+        j["operations"].push_back({
+            {"name",        s.first},
+            {"count",       ms.size()},
+            {"errors",      s.second.errors},
+            {"ops_per_s",   ms.size()/elapsed.count()},
+            {"bytes_per_s", s.second.bytes/elapsed.count()},
+            {"p50_ms",      percentile(ms, .5)},
+            {"p90_ms",      percentile(ms, .9)},
+            {"p99_ms",      percentile(ms, .99)},
+            {"p999_ms",     percentile(ms, .999)},
+            {"max_ms",      ms.empty() ? 0. : ms.back()}
+        });
+    }
+
+    if (la.output.empty()) {
+        std::cout << j.dump(4) << std::endl;
+    } else {
+        std::ofstream out(la.output);
+        if (not out.is_open()) {
+            std::cerr << "Can't open " << la.output << std::endl;
+            return 1;
+        }
+        out << j.dump(4) << std::endl;
+    }
+    return 0;
+}
+
+} /* bench */
+} /* dpaste */
+
+int main(int argc, char *argv[]) {
+    auto la = dpaste::bench::parse_args(argc, argv);
+    if (la.fail) {
+        return 1;
+    } else if (la.help) {
+        dpaste::bench::print_help();
+        return 0;
+    }
+    try {
+        return dpaste::bench::run(la);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
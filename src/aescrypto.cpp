@@ -22,24 +22,70 @@
 
 #include "log.h"
 #include "aescrypto.h"
+#include "trace.h"
+#include "metrics.h"
+#include "probes.h"
 
 namespace dpaste {
 namespace crypto {
 
+namespace {
+
+const Metrics::Histogram& crypto_seconds(const char* op) {
+    return Metrics::histogram("dpaste_crypto_seconds", "Time spent encrypting and decrypting, by scheme.",
+                              std::string("scheme=\"aes\",op=\"")+op+"\"");
+}
+
+} /* anonymous namespace */
+
+const constexpr size_t AES::KEY_LEN;
+
 std::string AES::getPassword(const std::shared_ptr<Parameters>& params) const {
     if (auto p = std::get_if<AESParameters>(params.get()))
         return p->password;
     return {};
 }
 
+const std::vector<uint8_t>* AES::getKey(const std::shared_ptr<Parameters>& params) const {
+    auto p = std::get_if<AESParameters>(params.get());
+    return p and not p->key.empty() ? &p->key : nullptr;
+}
+
+std::vector<uint8_t> AES::deriveKey(const std::string& password, std::vector<uint8_t>& salt) {
+    DPASTE_TRACE_SCOPE("aes derive key", "crypto");
+    return dht::crypto::stretchKey(password, salt, KEY_LEN);
+}
+
 std::vector<uint8_t> AES::processPlainText(std::vector<uint8_t> plain_text, std::shared_ptr<Parameters>&& params) {
-    DPASTE_MSG("Encrypting (aes-gcm) data...");
-    return dht::crypto::aesEncrypt(plain_text, getPassword(params));
+    DPASTE_TRACE_SCOPE("aes encrypt", "crypto", plain_text.size());
+    static const auto& seconds = crypto_seconds("encrypt");
+    Metrics::Histogram::Timer timer {seconds};
+    DPASTE_PROBE2(cipher_encrypt_entry, static_cast<int>(AESParameters::scheme), plain_text.size());
+    std::vector<uint8_t> cipher_text;
+    if (auto key = getKey(params))
+        cipher_text = dht::crypto::aesEncrypt(plain_text, *key);
+    else {
+        DPASTE_LOG_INFO("Encrypting (aes-gcm) data...");
+        cipher_text = dht::crypto::aesEncrypt(plain_text, getPassword(params));
+    }
+    DPASTE_PROBE2(cipher_encrypt_return, cipher_text.size(), 0);
+    return cipher_text;
 }
 
 std::vector<uint8_t> AES::processCipherText(std::vector<uint8_t> cipher_text, std::shared_ptr<Parameters>&& params) {
-    DPASTE_MSG("Decrypting (aes-gcm)...");
-    return dht::crypto::aesDecrypt(cipher_text, getPassword(params));
+    DPASTE_TRACE_SCOPE("aes decrypt", "crypto", cipher_text.size());
+    static const auto& seconds = crypto_seconds("decrypt");
+    Metrics::Histogram::Timer timer {seconds};
+    DPASTE_PROBE2(cipher_decrypt_entry, static_cast<int>(AESParameters::scheme), cipher_text.size());
+    std::vector<uint8_t> plain_text;
+    if (auto key = getKey(params))
+        plain_text = dht::crypto::aesDecrypt(cipher_text, *key);
+    else {
+        DPASTE_LOG_INFO("Decrypting (aes-gcm)...");
+        plain_text = dht::crypto::aesDecrypt(cipher_text, getPassword(params));
+    }
+    DPASTE_PROBE2(cipher_decrypt_return, plain_text.size(), 0);
+    return plain_text;
 }
 
 } /* crypto */
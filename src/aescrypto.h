@@ -43,15 +43,33 @@ public:
      */
     static const constexpr size_t CODE_PASS_OFFSET {4};
 
+    /**
+     * Length of the key derived by deriveKey (256 bits).
+     */
+    static const constexpr size_t KEY_LEN {32};
+
     AES() {}
     virtual ~AES () {}
 
+    /**
+     * Stretch a password into a key. Encrypting many blobs with a key derived
+     * once spares the (deliberately slow) stretching for each of them.
+     *
+     * @param password  The password.
+     * @param salt      The salt. If empty, a random one is generated and
+     *                  stored in it.
+     *
+     * @return the key.
+     */
+    static std::vector<uint8_t> deriveKey(const std::string& password, std::vector<uint8_t>& salt);
+
     std::vector<uint8_t>
         processPlainText(std::vector<uint8_t> plain_text, std::shared_ptr<Parameters>&& params) override;
     std::vector<uint8_t>
         processCipherText(std::vector<uint8_t> cipher_text, std::shared_ptr<Parameters>&& params) override;
 private:
     std::string getPassword(const std::shared_ptr<Parameters>& params) const;
+    const std::vector<uint8_t>* getKey(const std::shared_ptr<Parameters>& params) const;
 };
 
 } /* crypto */
@@ -0,0 +1,129 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+#include <sys/resource.h>
+
+#include "alloc.h"
+
+namespace {
+
+std::atomic_bool enabled_ {false};
+std::atomic<uint64_t> allocs_ {0};
+std::atomic<uint64_t> bytes_ {0};
+std::atomic<uint64_t> frees_ {0};
+/* plain data, so that no TLS initialization runs inside operator new */
+thread_local uint64_t thread_allocs_ {0};
+thread_local uint64_t thread_bytes_ {0};
+thread_local uint64_t thread_frees_ {0};
+
+void count_alloc(std::size_t size) {
+    if (not enabled_.load(std::memory_order_relaxed))
+        return;
+    ++thread_allocs_;
+    thread_bytes_ += size;
+    allocs_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(size, std::memory_order_relaxed);
+}
+
+void count_free() {
+    if (not enabled_.load(std::memory_order_relaxed))
+        return;
+    ++thread_frees_;
+    frees_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void* allocate(std::size_t size) {
+    count_alloc(size);
+    for (;;) {
+        if (auto p = std::malloc(size ? size : 1))
+            return p;
+        auto handler = std::get_new_handler();
+        if (not handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void deallocate(void* p) noexcept {
+    if (p)
+        count_free();
+    std::free(p);
+}
+
+} /* anonymous namespace */
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return allocate(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& nt) noexcept { return operator new(size, nt); }
+
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::size_t) noexcept { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+
+namespace dpaste {
+
+void Alloc::enable() {
+    enabled_ = true;
+}
+
+void Alloc::disable() {
+    enabled_ = false;
+}
+
+bool Alloc::enabled() {
+    return enabled_;
+}
+
+Alloc::Counts Alloc::thread() {
+    return {thread_allocs_, thread_bytes_, thread_frees_};
+}
+
+Alloc::Counts Alloc::process() {
+    return {allocs_.load(std::memory_order_relaxed), bytes_.load(std::memory_order_relaxed),
+            frees_.load(std::memory_order_relaxed)};
+}
+
+uint64_t Alloc::peak_rss() {
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage))
+        return 0;
+    /* kilobytes on Linux */
+    return static_cast<uint64_t>(usage.ru_maxrss)*1024;
+}
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
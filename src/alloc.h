@@ -0,0 +1,70 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace dpaste {
+
+/**
+ * Heap allocations counted by dpaste's replacements of the global operator
+ * new and delete. Counting is off until enable(), which leaves a single
+ * branch on each allocation.
+ *
+ * Only allocations through operator new are seen: those of the C libraries
+ * dpaste uses (e.g. msgpack's sbuffer, curl or gpgme) go to malloc directly.
+ */
+class Alloc {
+public:
+    struct Counts {
+        uint64_t allocs {0};
+        uint64_t bytes {0};
+        uint64_t frees {0};
+
+        Counts operator-(const Counts& o) const { return {allocs-o.allocs, bytes-o.bytes, frees-o.frees}; }
+    };
+
+    static void enable();
+    /**
+     * Stop counting. The counts so far are kept.
+     */
+    static void disable();
+    static bool enabled();
+
+    /**
+     * @return the allocations of the calling thread since counting started.
+     */
+    static Counts thread();
+
+    /**
+     * @return the allocations of every thread since counting started.
+     */
+    static Counts process();
+
+    /**
+     * @return the peak resident set size of the process, in bytes.
+     */
+    static uint64_t peak_rss();
+};
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
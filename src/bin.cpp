@@ -23,6 +23,14 @@
 #include <array>
 #include <iomanip>
 #include <memory>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <condition_variable>
+#include <algorithm>
+#include <set>
+#include <cstring>
+#include <thread>
 
 #include <msgpack.hpp>
 
@@ -31,55 +39,725 @@
 #include "log.h"
 #include "gpgcrypto.h"
 #include "aescrypto.h"
+#include "hash.h"
+#include "erasure.h"
+#include "chunker.h"
+#include "stats.h"
+#include "metrics.h"
+#include "probes.h"
 
 namespace dpaste {
 
 const constexpr uint8_t Bin::PROTO_VERSION;
+const constexpr std::chrono::milliseconds Bin::NODE_HEDGE_DELAY;
+const constexpr size_t Bin::PART_SIZE;
+const constexpr size_t Bin::PARTS_IN_FLIGHT;
+const constexpr unsigned Bin::PART_FETCH_ATTEMPTS;
+const constexpr size_t Bin::STRIPE_SIZE;
+const constexpr size_t Bin::CHUNK_MIN_SIZE;
+const constexpr size_t Bin::CHUNK_AVG_SIZE;
+const constexpr std::chrono::milliseconds Bin::WATCH_POLL_PERIOD;
+const constexpr size_t Bin::STREAM_BATCH_SIZE;
+const constexpr std::chrono::milliseconds Bin::STREAM_BATCH_DELAY;
+const constexpr uint64_t Bin::STREAM_SEGMENT_SIZE;
+const constexpr std::chrono::seconds Bin::STREAM_GAP_TIMEOUT;
+const constexpr std::chrono::minutes Bin::REFRESH_PERIOD;
+const constexpr size_t Bin::REFRESH_BATCH_SIZE;
+const constexpr double Bin::REFRESH_MAX_RATE;
+const constexpr std::chrono::seconds Bin::REFRESH_IDLE_DELAY;
+const constexpr size_t Bin::TAG_LEN;
+const constexpr unsigned Bin::MAX_REPLICAS;
 
-Bin::Bin() {
+namespace {
+
+/*
+ * Values announced to a listener and consumed by another thread. It is shared
+ * with the listen callback, which may still run after the listener is gone.
+ */
+struct Inbox {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<dht::Blob> values;
+};
+
+Node::ListenCallback to_inbox(std::shared_ptr<Inbox> inbox) {
+    return [inbox](const dht::Blob& v) {
+        std::lock_guard<std::mutex> lk(inbox->mtx);
+        inbox->values.push_back(v);
+        inbox->cv.notify_all();
+        return true;
+    };
+}
+
+} /* anonymous */
+const constexpr char* Bin::SIGNED_HASH;
+const constexpr char* Bin::MERKLE_HASH;
+const constexpr char* Bin::MERKLE_INDEX_HASH;
+
+Bin::Bin(const std::map<std::string, std::string>& options) {
+    Stats::Span span {"config"};
     /* load dpaste config */
     auto config_file = conf::ConfigurationFile();
     config_file.load();
     conf_ = config_file.getConfiguration();
+    for (const auto& o : options)
+        conf_[o.first] = o.second;
 
     long port;
     {
         std::istringstream conv(conf_.at("port"));
         conv >> port;
     }
+    {
+        unsigned parity {0};
+        std::istringstream conv(conf_.at("parity"));
+        conv >> parity;
+        set_parity(parity);
+    }
+    {
+        unsigned replicas {1};
+        std::istringstream conv(conf_.at("replicas"));
+        conv >> replicas;
+        set_replicas(replicas);
+    }
+
+    {
+        const auto& bootstrap = conf_.at("bootstrap");
+        const auto colon = bootstrap.rfind(':');
+        bootstrap_host_ = bootstrap.substr(0, colon);
+        if (colon != std::string::npos)
+            bootstrap_port_ = bootstrap.substr(colon+1);
+    }
 
-    node.run();
     http_client_ = std::make_unique<HttpClient>(conf_.at("host"), port);
 }
 
+void Bin::run_node() {
+    if (bootstrap_port_.empty())
+        node.run(0, bootstrap_host_);
+    else
+        node.run(0, bootstrap_host_, bootstrap_port_);
+}
+
+void Bin::set_parity(unsigned parity) {
+    parity_ = std::min<size_t>(parity, ReedSolomon::MAX_SHARDS-STRIPE_SIZE);
+}
+
+template <typename T>
+T Bin::await_proxy(std::future<T>&& request) {
+    if (request.wait_for(NODE_HEDGE_DELAY) == std::future_status::timeout) {
+        std::lock_guard<std::mutex> lk(node_start_mtx_);
+        if (not node_start_.valid())
+            node_start_ = std::async(std::launch::async, [this]() { run_node(); });
+    }
+    return request.get();
+}
+
+std::vector<uint8_t> Bin::fetch(const std::string& code,
+                                const std::function<bool(const std::vector<uint8_t>&)>& accept,
+                                const std::atomic_bool* cancel,
+                                unsigned replicas)
+{
+    /* first try http server */
+    auto data_str = await_proxy(std::async(std::launch::async, [&]() {
+        Stats::Span span {"proxy get"};
+        auto data = http_client_->get(code);
+        span.bytes_out(data.size());
+        return data;
+    }));
+    std::vector<uint8_t> data {data_str.begin(), data_str.end()};
+    if (not data.empty())
+        reached_network_ = true;
+    if (not data.empty() and (not accept or accept(data)))
+        return data;
+    if (cancel and *cancel)
+        return {};
+
+    /* if fail, then perform request from local node */
+    run_node();
+    size_t examined {0};
+    Stats::Span span {"dht get"};
+    auto value = node.get(code, accept, &examined, replicas);
+    span.bytes_out(value.size());
+    if (examined)
+        reached_network_ = true;
+    if (value.empty() ? examined : examined > 1)
+        DPASTE_LOG_WARN("Skipped %zu unusable values under %s.", value.empty() ? examined : examined-1, code.c_str());
+    return value;
+}
+
+std::vector<uint8_t> Bin::fetch_part(const crypto::Merkle::Digest& leaf, const std::atomic_bool* cancel,
+                                     unsigned replicas)
+{
+    if (journal_) {
+        static const auto& hits = Metrics::counter("dpaste_part_cache_hits_total",
+                "Parts read from the resume journal rather than fetched.");
+        static const auto& misses = Metrics::counter("dpaste_part_cache_misses_total",
+                "Parts missing from the resume journal.");
+        auto part = journal_->part(leaf);
+        if (not part.empty() and crypto::Merkle::leaf(part) == leaf) {
+            hits.add();
+            return part;
+        }
+        misses.add();
+    }
+    const auto code = crypto::Sha256::toHex(leaf);
+    for (unsigned i = 0; i < PART_FETCH_ATTEMPTS and not (cancel and *cancel); ++i) {
+        auto part = fetch(code, [&](const std::vector<uint8_t>& v) { return crypto::Merkle::leaf(v) == leaf; },
+                          cancel, replicas);
+        if (not part.empty()) {
+            if (journal_)
+                journal_->done(leaf, part);
+            return part;
+        }
+    }
+    return {};
+}
+
+std::vector<std::vector<uint8_t>> Bin::fetch_stripe(const std::vector<crypto::Merkle::Digest>& leaves, size_t k,
+                                                    std::vector<std::future<void>>& stragglers,
+                                                    unsigned replicas)
+{
+    struct Stripe {
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::vector<std::vector<uint8_t>> parts;
+        size_t received {0};
+        size_t done {0};
+        std::atomic_bool enough {false};
+    };
+    auto stripe = std::make_shared<Stripe>();
+    stripe->parts.resize(leaves.size());
+
+    for (size_t i = 0; i < leaves.size(); ++i)
+        stragglers.emplace_back(std::async(std::launch::async, [this, stripe, i, k, leaf = leaves[i], replicas]() {
+            auto part = fetch_part(leaf, &stripe->enough, replicas);
+            std::lock_guard<std::mutex> lk(stripe->mtx);
+            if (not part.empty() and not stripe->enough) {
+                stripe->parts[i] = std::move(part);
+                if (++stripe->received == k)
+                    stripe->enough = true;
+            }
+            ++stripe->done;
+            stripe->cv.notify_all();
+        }));
+
+    std::vector<std::vector<uint8_t>> parts;
+    {
+        std::unique_lock<std::mutex> lk(stripe->mtx);
+        stripe->cv.wait(lk, [&]() { return stripe->enough or stripe->done == leaves.size(); });
+        if (not stripe->enough)
+            return {};
+        /* parts are not touched anymore once there are enough of them */
+        parts = std::move(stripe->parts);
+    }
+
+    if (not ReedSolomon(k, leaves.size()-k).reconstruct(parts))
+        return {};
+    parts.resize(k);
+    for (size_t i = 0; i < k; ++i)
+        if (crypto::Merkle::leaf(parts[i]) != leaves[i])
+            return {};
+    return parts;
+}
+
+bool Bin::store(const std::string& code, std::vector<uint8_t>&& blob, unsigned replicas) {
+    if (keeper_)
+        for (unsigned r = 0; r < replicas; ++r)
+            keeper_->keep(Node::replica_code(code, r), blob);
+    if (spool_) {
+        for (unsigned r = 0; r < replicas; ++r)
+            spool_->keep(Node::replica_code(code, r), blob);
+        return true;
+    }
+    bool success {true};
+    for (unsigned r = 0; r < replicas and success; ++r)
+        success = await_proxy(std::async(std::launch::async, [&]() {
+            Stats::Span span {"proxy put", blob.size()};
+            return http_client_->put(Node::replica_code(code, r), {blob.begin(), blob.end()});
+        }));
+    if (not success) {
+        run_node();
+        Stats::Span span {"dht put", blob.size()*replicas};
+        success = node.paste(code, std::move(blob), replicas);
+    }
+    if (success)
+        reached_network_ = true;
+    return success;
+}
+
+std::vector<bool> Bin::find_parts(const std::vector<crypto::Merkle::Digest>& leaves) {
+    std::vector<bool> found(leaves.size());
+    if (journal_) {
+        for (size_t i = 0; i < leaves.size(); ++i)
+            found[i] = journal_->has(leaves[i]);
+        return found;
+    }
+    std::deque<std::pair<size_t, std::future<bool>>> pending;
+    for (size_t i = 0; i < leaves.size(); ++i) {
+        if (pending.size() >= PARTS_IN_FLIGHT) {
+            found[pending.front().first] = pending.front().second.get();
+            pending.pop_front();
+        }
+        pending.emplace_back(i, std::async(std::launch::async, [this, &leaf = leaves[i]]() {
+            return not fetch(crypto::Sha256::toHex(leaf), [&](const std::vector<uint8_t>& v) {
+                return crypto::Merkle::leaf(v) == leaf;
+            }).empty();
+        }));
+    }
+    for (auto& f : pending)
+        found[f.first] = f.second.get();
+    return found;
+}
+
+bool Bin::store_parts(const std::vector<crypto::Merkle::Digest>& leaves, std::vector<std::vector<uint8_t>>&& parts,
+                      unsigned replicas)
+{
+    std::deque<std::future<bool>> pending;
+    bool success {true};
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (parts[i].empty())
+            continue;
+        if (pending.size() >= PARTS_IN_FLIGHT) {
+            success = pending.front().get() and success;
+            pending.pop_front();
+        }
+        pending.emplace_back(std::async(std::launch::async,
+            [this, &leaf = leaves[i], part = std::move(parts[i]), replicas]() mutable {
+                auto success = store(crypto::Sha256::toHex(leaf), std::move(part), replicas);
+                if (success and journal_)
+                    journal_->done(leaf);
+                return success;
+            }));
+    }
+    for (auto& f : pending)
+        success = f.get() and success;
+    return success;
+}
+
 std::string Bin::code_from_dpaste_uri(const std::string& uri) {
     static const std::string DUP {DPASTE_URI_PREFIX};
     const auto p = uri.find(DUP);
     return uri.substr(p != std::string::npos ? p+DUP.length() : 0);
 }
 
-std::pair<bool, std::string> Bin::get(std::string&& code, bool no_decrypt) {
+bool Bin::get(std::string&& code, std::ostream& out, bool no_decrypt) {
+    DPASTE_PROBE(bin_get_entry);
+    journal_.reset();
+    code = code_from_dpaste_uri(code);
+
+    /*
+     * A single value is decrypted (and thus authenticated) while looking for
+     * it. Values may be examined concurrently, and the one returned is not
+     * necessarily the last examined: the output of each usable single value
+     * is kept along with it, and the one returned is told by its content.
+     */
+    std::mutex mtx;
+    std::map<std::vector<uint8_t>, std::string> singles;
+    std::atomic_bool rejected {false};
+    auto data = fetch(code.substr(0, crypto::AES::CODE_PASS_OFFSET*2), [&](const std::vector<uint8_t>& v) {
+        Packet p;
+        try {
+            p.deserialize(v);
+        } catch (const std::exception& e) { }
+        if (not tagged_for(p, code))
+            return false;
+        if (p.streamed)
+            return true;
+        bool usable {false};
+        if (p.parts.empty()) {
+            std::ostringstream single;
+            try {
+                usable = write_value(std::vector<uint8_t> {v}, code, single, no_decrypt);
+            } catch (const std::exception& e) {
+                DPASTE_LOG_WARN("%s", e.what());
+            }
+            if (usable) {
+                std::lock_guard<std::mutex> lk(mtx);
+                singles.emplace(v, single.str());
+            }
+        } else
+            usable = crypto::Merkle::root(p.parts) == p.root;
+        if (not usable)
+            rejected = true;
+        return usable;
+    }, nullptr, replicas_);
+    bool success;
+    [[maybe_unused]] const auto size = data.size();
+    const auto single = singles.find(data);
+    if (data.empty())
+        success = not rejected;
+    else if (single != singles.end()) {
+        out << single->second;
+        success = true;
+    } else
+        success = write_value(std::move(data), code, out, no_decrypt);
+    DPASTE_PROBE2(bin_get_return, size, success ? 0 : -1);
+    return success;
+}
+
+bool Bin::watch(std::string&& code, std::ostream& out, bool no_decrypt, const std::atomic_bool* stop) {
+    journal_.reset();
+    code = code_from_dpaste_uri(code);
+    const auto lcode = code.substr(0, crypto::AES::CODE_PASS_OFFSET*2);
+
+    /* values are written from this thread: writing a paste may need the DHT */
+    auto inbox = std::make_shared<Inbox>();
+    std::set<crypto::Sha256::Digest> seen;
+    run_node();
+    auto token = node.listen(lcode, to_inbox(inbox));
+
+    bool success {true};
+    while (not (stop and *stop)) {
+        std::deque<dht::Blob> values;
+        {
+            std::unique_lock<std::mutex> lk(inbox->mtx);
+            inbox->cv.wait_for(lk, WATCH_POLL_PERIOD, [&]() { return not inbox->values.empty(); });
+            values.swap(inbox->values);
+        }
+        for (auto& v : values) {
+            if (not seen.insert(crypto::Sha256::hash(v)).second)
+                continue;
+            success = write_value(std::move(v), code, out, no_decrypt) and success;
+            out.flush();
+        }
+    }
+    node.cancel_listen(lcode, token);
+    return success;
+}
+
+std::string Bin::stream_code(const std::string& lcode, uint64_t segment) {
+    return segment ? lcode+':'+std::to_string(segment) : lcode;
+}
+
+std::vector<uint8_t> Bin::code_tag(const std::string& code) {
+    static const std::string TAG_INFO {"dpaste code tag"};
+    auto tag = crypto::Sha256::hmac({code.begin(), code.end()},
+                                    reinterpret_cast<const uint8_t*>(TAG_INFO.data()), TAG_INFO.size());
+    return {tag.begin(), tag.begin()+TAG_LEN};
+}
+
+bool Bin::tagged_for(const std::vector<uint8_t>& value, const std::string& code) {
+    Packet p;
+    try {
+        p.deserialize(value);
+    } catch (const std::exception& e) {
+        return true;
+    }
+    return tagged_for(p, code);
+}
+
+std::vector<uint8_t> Bin::stream_data(const Packet& p, const std::string& pwd,
+                                      std::shared_ptr<crypto::Parameters>& params)
+{
+    if (p.scheme != crypto::Cipher::Scheme::AES)
+        return p.data;
+    if (not params) {
+        auto salt = p.salt;
+        params = std::make_shared<crypto::Parameters>();
+        params->emplace<crypto::AESParameters>(crypto::AES::deriveKey(pwd, salt));
+    }
+    return crypto::Cipher::get(p.scheme)->processCipherText(p.data, std::shared_ptr<crypto::Parameters>(params));
+}
+
+bool Bin::stream(std::istream& in, std::unique_ptr<crypto::Parameters>&& params,
+                 const std::function<void(const std::string&)>& on_code)
+{
+    journal_.reset();
+    if (params and not std::holds_alternative<crypto::AESParameters>(*params)) {
+        DPASTE_LOG_ERROR("Only AES encryption is supported for streams.");
+        return false;
+    }
+    const auto lcode = random_pin();
+    std::string pwd;
+    std::vector<uint8_t> salt;
+    std::shared_ptr<crypto::Cipher> cipher;
+    std::shared_ptr<crypto::Parameters> key;
+    if (params) {
+        pwd = random_pin();
+        key = std::make_shared<crypto::Parameters>();
+        key->emplace<crypto::AESParameters>(crypto::AES::deriveKey(pwd, salt));
+        cipher = crypto::Cipher::get(crypto::Cipher::Scheme::AES);
+    }
+    const auto tag = code_tag(lcode+pwd);
+    on_code(DPASTE_URI_PREFIX+lcode+pwd);
+
+    /* lines are read in the background so that batches are sent on time */
+    struct {
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::vector<uint8_t> data;
+        bool eof {false};
+    } input;
+    std::thread reader([&]() {
+        std::vector<uint8_t> line;
+        char c;
+        while (in.get(c)) {
+            line.push_back(c);
+            if (c == '\n' or line.size() >= STREAM_BATCH_SIZE) {
+                std::lock_guard<std::mutex> lk(input.mtx);
+                input.data.insert(input.data.end(), line.begin(), line.end());
+                input.cv.notify_all();
+                line.clear();
+            }
+        }
+        std::lock_guard<std::mutex> lk(input.mtx);
+        input.data.insert(input.data.end(), line.begin(), line.end());
+        input.eof = true;
+        input.cv.notify_all();
+    });
+
+    uint64_t seq {0};
+    bool success {true};
+    std::deque<std::future<bool>> pending;
+    auto send = [&](std::vector<uint8_t>&& data, bool eof) {
+        Packet p;
+        p.streamed = true;
+        p.seq = seq;
+        p.eof = eof;
+        p.tag = tag;
+        if (cipher) {
+            p.scheme = crypto::Cipher::Scheme::AES;
+            p.salt = salt;
+            p.data = cipher->processPlainText(std::move(data), std::shared_ptr<crypto::Parameters>(key));
+        } else
+            p.data = std::move(data);
+        if (pending.size() >= PARTS_IN_FLIGHT) {
+            success = pending.front().get() and success;
+            pending.pop_front();
+        }
+        pending.emplace_back(std::async(std::launch::async,
+            [this, code = stream_code(lcode, seq/STREAM_SEGMENT_SIZE), blob = p.serialize()]() mutable {
+                return store(code, std::move(blob));
+            }));
+        ++seq;
+    };
+
+    std::unique_lock<std::mutex> lk(input.mtx);
+    for (bool eof = false; not eof;) {
+        input.cv.wait_for(lk, STREAM_BATCH_DELAY, [&]() {
+            return input.eof or input.data.size() >= STREAM_BATCH_SIZE;
+        });
+        eof = input.eof;
+        std::vector<uint8_t> data;
+        data.swap(input.data);
+        lk.unlock();
+        size_t offset {0};
+        do {
+            const auto n = std::min(STREAM_BATCH_SIZE, data.size()-offset);
+            const bool last = offset+n == data.size();
+            if (n or eof)
+                send({data.begin()+offset, data.begin()+offset+n}, eof and last);
+            offset += n;
+        } while (offset < data.size());
+        lk.lock();
+    }
+    lk.unlock();
+    reader.join();
+    for (auto& f : pending)
+        success = f.get() and success;
+    return success;
+}
+
+bool Bin::follow(std::string&& code, std::ostream& out, const std::atomic_bool* stop) {
+    journal_.reset();
     code = code_from_dpaste_uri(code);
     const auto offset = crypto::AES::CODE_PASS_OFFSET*2;
     const auto lcode = code.substr(0, offset);
-    const auto pwd = code.substr(offset);
+    const auto pwd = code.substr(std::min(offset, code.size()));
 
-    /* first try http server */
-    auto data_str = http_client_->get(lcode);
-    std::vector<uint8_t> data {data_str.begin(), data_str.end()};
+    /* listen to the segment of the next value and to the one after */
+    auto inbox = std::make_shared<Inbox>();
+    std::map<uint64_t, std::shared_future<size_t>> listens;
+    uint64_t next {0};
+    auto relisten = [&]() {
+        const auto segment = next/STREAM_SEGMENT_SIZE;
+        for (auto it = listens.begin(); it != listens.end();) {
+            if (it->first < segment) {
+                node.cancel_listen(stream_code(lcode, it->first), it->second);
+                it = listens.erase(it);
+            } else
+                ++it;
+        }
+        for (auto s : {segment, segment+1})
+            if (not listens.count(s))
+                listens.emplace(s, node.listen(stream_code(lcode, s), to_inbox(inbox)));
+    };
+    run_node();
+    relisten();
 
-    /* if fail, then perform request from local node */
-    if (data.empty()) {
-        /* get a pasted blob */
-        auto values = node.get(lcode);
-        if (not values.empty())
-            data = values.front();
+    std::map<uint64_t, Packet> pending;
+    std::shared_ptr<crypto::Parameters> params;
+    auto since = std::chrono::steady_clock::now();
+    bool eof {false}, success {true};
+    while (not (eof or (stop and *stop))) {
+        std::deque<dht::Blob> values;
+        {
+            std::unique_lock<std::mutex> lk(inbox->mtx);
+            inbox->cv.wait_for(lk, WATCH_POLL_PERIOD, [&]() { return not inbox->values.empty(); });
+            values.swap(inbox->values);
+        }
+        for (const auto& v : values) {
+            Packet p;
+            try {
+                p.deserialize(v);
+            } catch (const std::exception& e) {
+                continue;
+            }
+            if (p.streamed and p.seq >= next and tagged_for(p, code))
+                pending.emplace(p.seq, std::move(p));
+        }
+
+        /* give up on a missing value once later ones waited long enough */
+        const auto now = std::chrono::steady_clock::now();
+        if (pending.empty())
+            since = now;
+        else if (pending.begin()->first != next and now-since > STREAM_GAP_TIMEOUT) {
+            DPASTE_LOG_WARN("Values %llu to %llu of the stream are missing.", static_cast<unsigned long long>(next),
+                       static_cast<unsigned long long>(pending.begin()->first-1));
+            next = pending.begin()->first;
+        }
+        const auto first = next;
+        while (not (eof or pending.empty()) and pending.begin()->first == next) {
+            try {
+                auto data = stream_data(pending.begin()->second, pwd, params);
+                out.write(reinterpret_cast<const char*>(data.data()), data.size());
+                out.flush();
+            } catch (const dht::crypto::DecryptError& e) {
+                DPASTE_LOG_WARN("%s", e.what());
+                success = false;
+            }
+            eof = pending.begin()->second.eof;
+            pending.erase(pending.begin());
+            ++next;
+            since = now;
+        }
+        if (next/STREAM_SEGMENT_SIZE != first/STREAM_SEGMENT_SIZE)
+            relisten();
+    }
+    for (const auto& l : listens)
+        node.cancel_listen(stream_code(lcode, l.first), l.second);
+    return success;
+}
+
+bool Bin::refresh(const std::atomic_bool* stop) {
+    journal_.reset();
+    Keeper keeper {Keeper::path()};
+    run_node();
+
+    bool success {true}, warned {false};
+    while (not (stop and *stop)) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto kept = keeper.size();
+        if (not warned and kept > REFRESH_MAX_RATE*std::chrono::seconds(REFRESH_PERIOD).count()) {
+            DPASTE_LOG_WARN("%zu values are kept: some may expire before they are republished.", kept);
+            warned = true;
+        }
+        auto values = keeper.next(REFRESH_BATCH_SIZE);
+        std::vector<std::future<bool>> puts;
+        for (auto& v : values)
+            puts.emplace_back(std::async(std::launch::async, [this, &v]() {
+                return node.paste(v.first, std::move(v.second));
+            }));
+        size_t failed {0};
+        for (auto& f : puts)
+            failed += not f.get();
+        if (failed) {
+            DPASTE_LOG_WARN("Failed to republish %zu values.", failed);
+            success = false;
+        }
+
+        const auto deadline = start + (values.empty()
+            ? std::chrono::duration_cast<std::chrono::milliseconds>(REFRESH_IDLE_DELAY)
+            : Keeper::batch_delay(kept, REFRESH_BATCH_SIZE, REFRESH_PERIOD, REFRESH_MAX_RATE));
+        while (not (stop and *stop) and std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                WATCH_POLL_PERIOD, deadline-std::chrono::steady_clock::now()));
+    }
+    return success;
+}
+
+bool Bin::unkeep(std::string&& code) {
+    const auto pin = code_from_dpaste_uri(code).substr(0, crypto::AES::CODE_PASS_OFFSET*2);
+    Keeper keeper {Keeper::path()};
+    const auto codes = keeper.codes();
+    /* code of the value a replica or a stream segment is stored under */
+    auto base = [](const std::string& c) { return c.substr(0, c.find_first_of("/:")); };
+    auto leaves = [&](const std::string& c) {
+        std::set<std::string> hexes;
+        Packet p;
+        try {
+            p.deserialize(keeper.get(c));
+        } catch (const std::exception& e) { }
+        for (const auto& leaf : p.parts)
+            hexes.insert(crypto::Sha256::toHex(leaf));
+        return hexes;
+    };
+
+    std::set<std::string> parts;
+    for (const auto& c : codes)
+        if (base(c) == pin and c.find('/') == std::string::npos) {
+            auto l = leaves(c);
+            parts.insert(l.begin(), l.end());
+        }
+    /* parts are shared by the pastes of the same data (see Bin::update) */
+    for (const auto& c : codes)
+        if (c.size() == DPASTE_PIN_LEN and c != pin)
+            for (const auto& leaf : leaves(c))
+                parts.erase(leaf);
+
+    std::set<std::string> forgotten;
+    for (const auto& c : codes)
+        if (base(c) == pin or parts.count(base(c)))
+            forgotten.insert(c);
+    try {
+        if (keeper.forget(forgotten))
+            return true;
+    } catch (const std::exception& e) {
+        DPASTE_LOG_ERROR("%s", e.what());
+        return false;
     }
+    DPASTE_LOG_ERROR("No paste is kept under this code.");
+    return false;
+}
+
+bool Bin::write_value(std::vector<uint8_t>&& data, const std::string& code, std::ostream& out, bool no_decrypt) {
+    const auto offset = crypto::AES::CODE_PASS_OFFSET*2;
+    const auto pwd = code.substr(std::min(offset, code.size()));
 
     if (not data.empty()) {
         Packet p;
         try {
             p.deserialize(data);
+            if (not tagged_for(p, code)) {
+                DPASTE_LOG_WARN("Skipping a value pasted under another code.");
+                return false;
+            }
+            if (p.streamed) {
+                std::shared_ptr<crypto::Parameters> params;
+                data = no_decrypt ? std::move(p.data) : stream_data(p, pwd, params);
+                out.write(reinterpret_cast<const char*>(data.data()), data.size());
+                return true;
+            }
+            if (not p.files.empty()) {
+                if (not check_header(p))
+                    return false;
+                for (const auto& f : p.files)
+                    out << f.size << '\t' << f.name << std::endl;
+                return true;
+            }
+            if (not p.parts.empty()) {
+                Journal::prune(Node::VALUE_EXPIRATION);
+                journal_ = std::make_unique<Journal>(Journal::path("get-"+crypto::Sha256::toHex(p.root)));
+                if (not (resume_ and journal_->load()))
+                    journal_->reset();
+                auto success = get_parts(p, pwd, out, no_decrypt);
+                if (success)
+                    journal_->remove();
+                journal_.reset();
+                return success;
+            }
+
             auto cipher = crypto::Cipher::get(p.data, code);
             if (cipher and not no_decrypt) {
                 std::shared_ptr<crypto::Parameters> params;
@@ -87,44 +765,266 @@ std::pair<bool, std::string> Bin::get(std::string&& code, bool no_decrypt) {
                     params = std::make_shared<crypto::Parameters>();
                     params->emplace<crypto::AESParameters>(pwd);
                 }
+                Stats::Span span {"decrypt", p.data.size()};
                 data = cipher->processCipherText(p.data, std::move(params));
+                span.bytes_out(data.size());
             } else
                 data = std::move(p.data);
             if (not (cipher or p.signature.empty())) {
                 auto gc = std::dynamic_pointer_cast<crypto::GPG>(crypto::Cipher::get(crypto::Cipher::Scheme::GPG, {}));
-                DPASTE_MSG("Data is GPG signed. Verifying...");
-                auto res = gc->verify(p.signature, data);
-                if (res.numSignatures() > 0)
-                    gc->comment_on_signature(res.signature(0));
+                DPASTE_LOG_INFO("Data is GPG signed. Verifying...");
+                if (not (p.sighash.empty() or p.sighash == SIGNED_HASH)) {
+                    DPASTE_LOG_ERROR("Unsupported signature hash function: %s", p.sighash.c_str());
+                    return false;
+                }
+                auto res = p.sighash.empty() ? gc->verify(p.signature, data)
+                                             : gc->verify(p.signature,
+                                                          signed_manifest(SIGNED_HASH, crypto::Sha256::hash(data)),
+                                                          true);
+                if (not crypto::GPG::acceptable(res)) {
+                    DPASTE_LOG_ERROR("Bad or unverifiable signature: the data is not written.");
+                    return false;
+                }
+                gc->comment_on_signature(res.signature(0));
             }
         } catch (const GpgME::Exception& e) {
-            DPASTE_MSG("%s", e.what());
-            return {false, ""};
+            DPASTE_LOG_ERROR("%s", e.what());
+            return false;
         } catch (const dht::crypto::DecryptError& e) {
-            DPASTE_MSG("%s", e.what());
-            return {false, ""};
+            DPASTE_LOG_ERROR("%s", e.what());
+            return false;
         } catch (msgpack::type_error& e) { } /* backward compatibility with <=0.3.3 */
 
     }
-    return {true, {data.begin(), data.end()}};
+    Stats::Span span {"write", data.size()};
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return true;
 }
 
-std::vector<uint8_t> Bin::data_from_stream(std::stringstream&& input_stream) {
+bool Bin::extract(std::string&& code, std::ostream& out, const std::string& name, uint64_t offset, uint64_t length)
+{
+    journal_.reset();
+    code = code_from_dpaste_uri(code);
+    const auto pos = crypto::AES::CODE_PASS_OFFSET*2;
+    const auto lcode = code.substr(0, pos);
+    const auto pwd = code.substr(pos);
+
+    auto data = fetch(lcode, [&](const std::vector<uint8_t>& v) { return tagged_for(v, code); }, nullptr, replicas_);
+    Packet p;
+    try {
+        if (not data.empty())
+            p.deserialize(data);
+    } catch (msgpack::type_error& e) { }
+    if (p.parts.empty()) {
+        if (not name.empty()) {
+            DPASTE_LOG_ERROR("Not an archive paste.");
+            return false;
+        }
+        /* a single value: nothing to save by getting only part of it */
+        std::ostringstream oss;
+        if (not get(std::move(code), oss))
+            return false;
+        const auto content = oss.str();
+        const auto from = std::min<uint64_t>(offset, content.size());
+        out << content.substr(from, std::min<uint64_t>(length, content.size()-from));
+        return true;
+    }
+
+    if (not name.empty()) {
+        auto f = std::find_if(p.files.begin(), p.files.end(), [&](const Packet::File& f) { return f.name == name; });
+        if (f == p.files.end()) {
+            DPASTE_LOG_ERROR("No file named %s in paste.", name.c_str());
+            return false;
+        }
+        offset = std::min(offset, f->size);
+        length = std::min(length, f->size-offset);
+        offset += f->offset;
+    }
+    try {
+        return get_parts(p, pwd, out, false, offset, length);
+    } catch (const GpgME::Exception& e) {
+        DPASTE_LOG_ERROR("%s", e.what());
+    } catch (const dht::crypto::DecryptError& e) {
+        DPASTE_LOG_ERROR("%s", e.what());
+    }
+    return false;
+}
+
+bool Bin::check_header(const Packet& p) {
+    if (crypto::Merkle::root(p.parts) != p.root
+            or (p.parity and (not p.stripe or p.stripe+p.parity > ReedSolomon::MAX_SHARDS)))
+    {
+        DPASTE_LOG_ERROR("Corrupted paste header.");
+        return false;
+    }
+    /* the signature covers the root, so every part is authenticated before it is written */
+    if (not p.signature.empty() and p.scheme != crypto::Cipher::Scheme::GPG) {
+        if (p.sighash != p.manifest_hash()) {
+            DPASTE_LOG_ERROR("Unsupported signature hash function: %s", p.sighash.c_str());
+            return false;
+        }
+        auto gc = std::dynamic_pointer_cast<crypto::GPG>(crypto::Cipher::get(crypto::Cipher::Scheme::GPG, {}));
+        DPASTE_LOG_INFO("Data is GPG signed. Verifying...");
+        auto res = gc->verify(p.signature, signed_manifest(p.sighash, p.manifest()), true);
+        if (not crypto::GPG::acceptable(res)) {
+            DPASTE_LOG_ERROR("Bad or unverifiable signature: the data is not written.");
+            return false;
+        }
+        gc->comment_on_signature(res.signature(0));
+    }
+    return true;
+}
+
+bool Bin::get_parts(const Packet& p, const std::string& pwd, std::ostream& out, bool no_decrypt,
+                    uint64_t offset, uint64_t length)
+{
+    if (not check_header(p))
+        return false;
+
+    std::shared_ptr<crypto::Cipher> cipher;
+    std::shared_ptr<crypto::Parameters> params;
+    if (not no_decrypt and p.scheme != crypto::Cipher::Scheme::NONE) {
+        cipher = crypto::Cipher::get(p.scheme, {});
+        if (p.scheme == crypto::Cipher::Scheme::AES) {
+            if (pwd.empty()) {
+                DPASTE_LOG_ERROR("Missing password in code.");
+                return false;
+            }
+            DPASTE_LOG_INFO("Decrypting (aes-gcm)...");
+            auto salt = p.salt;
+            params = std::make_shared<crypto::Parameters>();
+            params->emplace<crypto::AESParameters>(crypto::AES::deriveKey(pwd, salt));
+        }
+    }
+    const bool ranged = offset or length != std::numeric_limits<uint64_t>::max();
+    if (ranged and no_decrypt and p.scheme != crypto::Cipher::Scheme::NONE) {
+        DPASTE_LOG_ERROR("Extracting encrypted data requires decrypting it.");
+        return false;
+    }
+    /* GPG can only decrypt the whole cipher text */
+    const bool buffered = cipher and p.scheme == crypto::Cipher::Scheme::GPG;
     std::vector<uint8_t> buffer;
-    buffer.resize(dht::MAX_VALUE_SIZE);
-    input_stream.read(reinterpret_cast<char*>(buffer.data()), dht::MAX_VALUE_SIZE);
-    buffer.resize(input_stream.gcount());
-    return buffer;
+
+    /* position of every data part in p.parts (see Packet::parity) */
+    std::vector<size_t> index;
+    const size_t n = p.parity ? p.stripe+p.parity : p.parts.size();
+    for (size_t first = 0; first < p.parts.size(); first += n) {
+        const auto count = std::min(n, p.parts.size()-first);
+        for (size_t j = 0; j+p.parity < count; ++j)
+            index.push_back(first+j);
+    }
+    if (not p.sizes.empty() and p.sizes.size() != index.size()) {
+        DPASTE_LOG_ERROR("Corrupted paste header.");
+        return false;
+    }
+    /* offset of the plain text of every data part */
+    std::vector<uint64_t> starts {0};
+    for (size_t i = 0; i < index.size(); ++i)
+        starts.push_back(starts.back() + (p.sizes.empty() ? PART_SIZE : p.sizes[i]));
+
+    /* the last data part may be padded (see Packet::parity) */
+    uint64_t begin {0}, end {p.size};
+    size_t first {0}, last {index.size()};
+    if (no_decrypt and p.scheme == crypto::Cipher::Scheme::AES)
+        end = std::numeric_limits<uint64_t>::max();
+    else if (not buffered) {
+        begin = std::min(offset, p.size);
+        end = length < p.size-begin ? begin+length : p.size;
+        first = std::upper_bound(starts.begin(), starts.end(), begin) - starts.begin() - 1;
+        last = std::lower_bound(starts.begin(), starts.end(), end) - starts.begin();
+        first = std::min(first, last);
+    }
+
+    /* write the part of the range found in the i-th data part */
+    auto write = [&](std::vector<uint8_t>&& part, size_t i) {
+        const auto s = starts[i];
+        if (buffered) {
+            buffer.insert(buffer.end(), part.begin(), part.begin()+std::min<uint64_t>(end-s, part.size()));
+            return;
+        } else if (cipher) {
+            Stats::Span span {"decrypt", part.size()};
+            part = cipher->processCipherText(std::move(part), std::shared_ptr<crypto::Parameters>(params));
+            span.bytes_out(part.size());
+        }
+        const auto from = std::max(begin, s)-s;
+        const auto until = std::min<uint64_t>(end-s, part.size());
+        if (until > from) {
+            Stats::Span span {"write", until-from};
+            out.write(reinterpret_cast<const char*>(part.data()+from), until-from);
+            out.flush();
+        }
+    };
+
+    if (p.parity) {
+        std::vector<std::future<void>> stragglers;
+        for (size_t s = first/p.stripe; s*p.stripe < last; ++s) {
+            const auto pos = s*n;
+            const auto count = std::min(n, p.parts.size()-pos);
+            auto parts = count > p.parity
+                ? fetch_stripe({p.parts.begin()+pos, p.parts.begin()+pos+count}, count-p.parity, stragglers,
+                               p.replicas)
+                : std::vector<std::vector<uint8_t>> {};
+            if (parts.empty()) {
+                DPASTE_LOG_ERROR("Failed to retrieve parts %zu to %zu of %zu.", pos+1, pos+count, p.parts.size());
+                return false;
+            }
+            for (size_t j = 0; j < parts.size(); ++j) {
+                const auto i = s*p.stripe+j;
+                if (first <= i and i < last)
+                    write(std::move(parts[j]), i);
+            }
+        }
+    } else {
+        std::deque<std::future<std::vector<uint8_t>>> pending;
+        size_t next {first};
+        for (size_t i = first; i < last; ++i) {
+            for (; next < last and pending.size() < PARTS_IN_FLIGHT; ++next)
+                pending.emplace_back(std::async(std::launch::async, [this, leaf = p.parts[index[next]], &p]() {
+                    return fetch_part(leaf, nullptr, p.replicas);
+                }));
+            auto part = pending.front().get();
+            pending.pop_front();
+            if (part.empty()) {
+                DPASTE_LOG_ERROR("Failed to retrieve part %zu of %zu.", index[i]+1, p.parts.size());
+                return false;
+            }
+            write(std::move(part), i);
+        }
+    }
+
+    if (buffered) {
+        {
+            Stats::Span span {"decrypt", buffer.size()};
+            buffer = cipher->processCipherText(std::move(buffer), {});
+            span.bytes_out(buffer.size());
+        }
+        const auto from = std::min<uint64_t>(offset, buffer.size());
+        const auto until = length < buffer.size()-from ? from+length : buffer.size();
+        Stats::Span span {"write", until-from};
+        out.write(reinterpret_cast<const char*>(buffer.data()+from), until-from);
+    }
+    return true;
+}
+
+std::vector<uint8_t> Bin::signed_manifest(const std::string& hash, const crypto::Sha256::Digest& digest) {
+    std::vector<uint8_t> m {hash.begin(), hash.end()};
+    m.push_back(':');
+    m.insert(m.end(), digest.begin(), digest.end());
+    return m;
+}
+
+std::vector<uint8_t> Bin::data_from_stream(std::stringstream&& input_stream) {
+    return {std::istreambuf_iterator<char>(input_stream), std::istreambuf_iterator<char>()};
 }
 
 std::string Bin::random_pin() {
-    static std::uniform_int_distribution<uint32_t> dist;
-    static std::mt19937_64 rand_;
-    static std::random_device rdev;
-    static std::seed_seq seed {rdev(), rdev()};
-    static bool initialized = false;
-    if (not initialized)
-        rand_.seed(seed);
+    /* seeded once per thread, so that concurrent pastes draw distinct codes */
+    static thread_local std::mt19937_64 rand_ = []() {
+        std::random_device rdev;
+        std::seed_seq seed {rdev(), rdev(), rdev(), rdev()};
+        return std::mt19937_64 {seed};
+    }();
+    std::uniform_int_distribution<uint32_t> dist;
 
     auto pin = dist(rand_);
     std::stringstream ss;
@@ -135,11 +1035,12 @@ std::string Bin::random_pin() {
 }
 
 std::pair<Bin::Packet, std::string> Bin::prepare_data(std::vector<uint8_t>&& data, std::unique_ptr<crypto::Parameters>&& params) {
+    Stats::Span span {"encrypt", data.size()};
     Packet p;
     std::string pwd = "";
     std::shared_ptr<crypto::Parameters> sparams(std::move(params));
     std::shared_ptr<crypto::Parameters> init_params;
-    crypto::Cipher::Scheme scheme;
+    crypto::Cipher::Scheme scheme {crypto::Cipher::Scheme::NONE};
 
     bool to_sign {false};
     if (auto gp = std::get_if<crypto::GPGParameters>(sparams.get())) {
@@ -161,33 +1062,387 @@ std::pair<Bin::Packet, std::string> Bin::prepare_data(std::vector<uint8_t>&& dat
         if (cipher_text.empty()) {
             p.data.insert(p.data.end(), data.begin(), data.end());
             if (to_sign) {
-                DPASTE_MSG("Signing data...");
-                auto res = std::dynamic_pointer_cast<crypto::GPG>(cipher)->sign(p.data);
+                DPASTE_LOG_INFO("Signing data...");
+                auto manifest = signed_manifest(SIGNED_HASH, crypto::Sha256::hash(p.data));
+                auto res = std::dynamic_pointer_cast<crypto::GPG>(cipher)->sign(manifest, true);
                 p.signature = res.first;
+                p.sighash = SIGNED_HASH;
             }
         } else
             p.data = cipher_text;
     } else
         p.data.insert(p.data.end(), data.begin(), data.end());
+    span.bytes_out(p.data.size());
+    return {p, pwd};
+}
+
+std::pair<Bin::Packet, std::string> Bin::prepare_parts(std::vector<uint8_t>&& data,
+                                                       std::unique_ptr<crypto::Parameters>&& params,
+                                                       std::vector<std::vector<uint8_t>>& parts,
+                                                       const Packet* base,
+                                                       const std::string& base_pwd,
+                                                       std::vector<Packet::File>&& files)
+{
+    Stats::Span span {"encrypt", data.size()};
+    Packet p;
+    p.files = std::move(files);
+    std::string pwd = "";
+    std::shared_ptr<crypto::Parameters> sparams(std::move(params));
+    std::shared_ptr<crypto::Parameters> part_params;
+    std::shared_ptr<crypto::Cipher> cipher;
+    std::vector<uint8_t> chunk_key;
+
+    bool to_sign {false};
+    if (auto gp = std::get_if<crypto::GPGParameters>(sparams.get())) {
+        auto& keyid = conf_.at("pgp_key_id");
+        to_sign = gp->sign and not keyid.empty();
+        auto init_params = std::make_shared<crypto::Parameters>();
+        init_params->emplace<crypto::GPGParameters>(keyid);
+        cipher = crypto::Cipher::get(gp->scheme, std::move(init_params));
+        auto cipher_text = cipher->processPlainText(data, std::move(sparams));
+        if (not cipher_text.empty()) {
+            /* signature, if any, is part of the cipher text */
+            to_sign = false;
+            p.scheme = crypto::Cipher::Scheme::GPG;
+            data = std::move(cipher_text);
+        }
+    } else if (auto aesp = std::get_if<crypto::AESParameters>(sparams.get())) {
+        p.scheme = aesp->scheme;
+        if (base) {
+            /* same key as the previous version for its parts to be reused */
+            pwd = base_pwd;
+            p.salt = base->salt;
+        } else
+            pwd = random_pin();
+        DPASTE_LOG_INFO("Encrypting (aes-gcm) data...");
+        auto key = crypto::AES::deriveKey(pwd, p.salt);
+        static const std::string CHUNK_KEY_INFO {"dpaste chunk id"};
+        auto ck = crypto::Sha256::hmac(key, reinterpret_cast<const uint8_t*>(CHUNK_KEY_INFO.data()),
+                                       CHUNK_KEY_INFO.size());
+        chunk_key = {ck.begin(), ck.end()};
+        part_params = std::make_shared<crypto::Parameters>();
+        part_params->emplace<crypto::AESParameters>(std::move(key));
+        cipher = crypto::Cipher::get(p.scheme);
+    }
+    const bool aes = p.scheme == crypto::Cipher::Scheme::AES;
+
+    p.size = data.size();
+    std::vector<size_t> ends;
+    if (parity_ or p.scheme == crypto::Cipher::Scheme::GPG) {
+        for (size_t end = PART_SIZE; end < data.size()+PART_SIZE; end += PART_SIZE)
+            ends.push_back(std::min(end, data.size()));
+    } else
+        ends = Chunker {CHUNK_MIN_SIZE, CHUNK_AVG_SIZE, PART_SIZE}.split(data);
+
+    /* identify each chunk and look for the ones the previous version already stored */
+    std::vector<crypto::Merkle::Digest> ids;
+    std::map<crypto::Merkle::Digest, crypto::Merkle::Digest> known;
+    std::vector<crypto::Merkle::Digest> candidates;
+    std::vector<bool> found;
+    if (not parity_ and p.scheme != crypto::Cipher::Scheme::GPG) {
+        for (size_t i = 0, begin = 0; i < ends.size(); begin = ends[i++]) {
+            const auto* chunk = data.data()+begin;
+            const auto len = ends[i]-begin;
+            p.sizes.push_back(len);
+            ids.emplace_back(aes ? crypto::Sha256::hmac(chunk_key, chunk, len)
+                                 : crypto::Merkle::leaf({chunk, chunk+len}));
+        }
+        if (base) {
+            const auto& base_ids = aes ? base->chunks : base->parts;
+            for (size_t i = 0; i < base_ids.size() and i < base->parts.size(); ++i)
+                known.emplace(base_ids[i], base->parts[i]);
+            for (const auto& id : ids) {
+                auto k = known.find(id);
+                if (k != known.end())
+                    candidates.emplace_back(k->second);
+            }
+            found = find_parts(candidates);
+            DPASTE_LOG_INFO("Reusing %zu out of %zu parts.",
+                    static_cast<size_t>(std::count(found.begin(), found.end(), true)), ends.size());
+        }
+    }
+
+    std::vector<std::vector<uint8_t>> data_parts;
+    std::vector<crypto::Merkle::Digest> leaves;
+    for (size_t i = 0, begin = 0, c = 0; i < ends.size(); begin = ends[i++]) {
+        if (not ids.empty() and known.count(ids[i]) and found[c++]) {
+            data_parts.emplace_back();
+            leaves.emplace_back(known[ids[i]]);
+            continue;
+        }
+        std::vector<uint8_t> part {data.begin()+begin, data.begin()+ends[i]};
+        /* erasure coding needs parts of equal length */
+        if (parity_)
+            part.resize(PART_SIZE);
+        if (aes)
+            part = cipher->processPlainText(std::move(part), std::shared_ptr<crypto::Parameters>(part_params));
+        if (not parity_)
+            leaves.emplace_back(crypto::Merkle::leaf(part));
+        data_parts.emplace_back(std::move(part));
+    }
+
+    if (parity_) {
+        p.parity = parity_;
+        p.stripe = STRIPE_SIZE;
+        for (size_t first = 0; first < data_parts.size(); first += STRIPE_SIZE) {
+            std::vector<std::vector<uint8_t>> stripe {
+                std::make_move_iterator(data_parts.begin()+first),
+                std::make_move_iterator(data_parts.begin()+std::min(data_parts.size(), first+STRIPE_SIZE))
+            };
+            auto parity = ReedSolomon(stripe.size(), parity_).encode(stripe);
+            std::move(stripe.begin(), stripe.end(), std::back_inserter(parts));
+            std::move(parity.begin(), parity.end(), std::back_inserter(parts));
+        }
+        for (const auto& part : parts)
+            p.parts.emplace_back(crypto::Merkle::leaf(part));
+    } else {
+        parts = std::move(data_parts);
+        p.parts = std::move(leaves);
+        if (aes)
+            p.chunks = std::move(ids);
+    }
+    p.root = crypto::Merkle::root(p.parts);
+
+    if (to_sign) {
+        DPASTE_LOG_INFO("Signing data...");
+        p.sighash = p.manifest_hash();
+        auto res = std::dynamic_pointer_cast<crypto::GPG>(cipher)->sign(signed_manifest(p.sighash, p.manifest()), true);
+        p.signature = res.first;
+    }
+    uint64_t size {0};
+    for (const auto& part : parts)
+        size += part.size();
+    span.bytes_out(size);
     return {p, pwd};
 }
 
 std::string Bin::paste(std::vector<uint8_t>&& data, std::unique_ptr<crypto::Parameters>&& params) {
-    auto code = random_pin();
+    return paste(std::forward<std::vector<uint8_t>>(data), std::forward<std::unique_ptr<crypto::Parameters>>(params),
+                 {});
+}
+
+std::string Bin::paste(std::vector<std::pair<std::string, std::vector<uint8_t>>>&& files,
+                       std::unique_ptr<crypto::Parameters>&& params)
+{
+    std::vector<uint8_t> data;
+    std::vector<Packet::File> index;
+    for (auto& f : files) {
+        index.push_back({f.first, data.size(), f.second.size()});
+        data.insert(data.end(), f.second.begin(), f.second.end());
+        f.second.clear();
+    }
+    return paste(std::move(data), std::forward<std::unique_ptr<crypto::Parameters>>(params), std::move(index));
+}
+
+std::string Bin::paste(std::vector<uint8_t>&& data, std::unique_ptr<crypto::Parameters>&& params,
+                       std::vector<Packet::File>&& files)
+{
+    DPASTE_PROBE2(bin_paste_entry, data.size(), files.size());
+    journal_.reset();
+    std::vector<std::vector<uint8_t>> parts;
+    if (data.size() <= PART_SIZE and files.empty()) {
+        auto uri = publish(prepare_data(std::forward<std::vector<uint8_t>>(data),
+                                        std::forward<std::unique_ptr<crypto::Parameters>>(params)),
+                           std::move(parts), random_pin());
+        DPASTE_PROBE1(bin_paste_return, uri.empty() ? -1 : 0);
+        return uri;
+    }
+
+    /* the journal is named after the data so that the next run finds it */
+    crypto::Sha256 h;
+    h.update(data);
+    h.update(reinterpret_cast<const uint8_t*>(&parity_), sizeof(parity_));
+    /* past expiration, the parts it lists are gone: resuming would skip them */
+    Journal::prune(Node::VALUE_EXPIRATION);
+    journal_ = std::make_unique<Journal>(Journal::path("paste-"+crypto::Sha256::toHex(h.digest())));
+
+    const auto offset = crypto::AES::CODE_PASS_OFFSET*2;
+    Packet base;
+    std::string code;
+    if (resume_ and journal_->load()) {
+        auto c = journal_->get("code");
+        code.assign(c.begin(), c.end());
+        try {
+            base.deserialize(journal_->get("header"));
+        } catch (const std::exception& e) {
+            base = {};
+        }
+    }
+    std::string base_pwd;
+    if (code.size() >= offset) {
+        DPASTE_LOG_INFO("Resuming previous paste...");
+        base_pwd = code.substr(offset);
+        code = code.substr(0, offset);
+    } else {
+        journal_->reset();
+        code = random_pin();
+    }
+
+    /* AES parts are only the same as the journaled ones if encrypted with the same key */
+    const bool aes = params and std::holds_alternative<crypto::AESParameters>(*params);
+    auto pp = prepare_parts(std::forward<std::vector<uint8_t>>(data),
+                            std::forward<std::unique_ptr<crypto::Parameters>>(params), parts,
+                            aes and base.scheme == crypto::Cipher::Scheme::AES ? &base : nullptr, base_pwd,
+                            std::move(files));
+    for (size_t i = 0; i < parts.size(); ++i)
+        if (journal_->has(pp.first.parts[i]))
+            parts[i].clear();
+    /* with the AES password, needed to resume: the journal is removed on success or pruned */
+    const auto full_code = code+pp.second;
+    journal_->set("code", {full_code.begin(), full_code.end()});
+    journal_->set("header", pp.first.serialize());
+
+    auto uri = publish(std::move(pp), std::move(parts), code);
+    if (not uri.empty())
+        journal_->remove();
+    journal_.reset();
+    DPASTE_PROBE1(bin_paste_return, uri.empty() ? -1 : 0);
+    return uri;
+}
 
-    auto pp = prepare_data(std::forward<std::vector<uint8_t>>(data), std::forward<std::unique_ptr<crypto::Parameters>>(params));
+std::string Bin::update(std::string&& code, std::vector<uint8_t>&& data, std::unique_ptr<crypto::Parameters>&& params) {
+    journal_.reset();
+    code = code_from_dpaste_uri(code);
+    const auto offset = crypto::AES::CODE_PASS_OFFSET*2;
+
+    Packet base;
+    auto header = fetch(code.substr(0, offset), [&](const std::vector<uint8_t>& v) { return tagged_for(v, code); },
+                        nullptr, replicas_);
+    try {
+        if (not header.empty())
+            base.deserialize(header);
+    } catch (msgpack::type_error& e) {
+        base = {};
+    }
+
+    const bool aes = params and std::holds_alternative<crypto::AESParameters>(*params);
+    const auto gp = params ? std::get_if<crypto::GPGParameters>(params.get()) : nullptr;
+    const bool gpg = gp and (not gp->recipients.empty() or gp->self_recipient);
+    if (base.parts.empty() or base.parity or parity_ or gpg or data.size() <= PART_SIZE
+            or base.scheme != (aes ? crypto::Cipher::Scheme::AES : crypto::Cipher::Scheme::NONE))
+    {
+        DPASTE_LOG_INFO("Nothing to reuse from the previous version. Pasting anew...");
+        return paste(std::forward<std::vector<uint8_t>>(data), std::forward<std::unique_ptr<crypto::Parameters>>(params));
+    }
+
+    std::vector<std::vector<uint8_t>> parts;
+    auto pp = prepare_parts(std::forward<std::vector<uint8_t>>(data),
+                            std::forward<std::unique_ptr<crypto::Parameters>>(params),
+                            parts, &base, code.substr(offset));
+    return publish(std::move(pp), std::move(parts), random_pin());
+}
+
+std::string Bin::publish(std::pair<Packet, std::string>&& pp, std::vector<std::vector<uint8_t>>&& parts,
+                         const std::string& code)
+{
     auto& p = pp.first;
     auto& pwd = pp.second;
+    p.tag = code_tag(code+pwd);
+    if (not p.parts.empty())
+        p.replicas = replicas_;
+    /* the packet lists every part: check it fits in a value before uploading any */
+    auto packet = p.serialize();
+    if (packet.size()+std::strlen(Node::DPASTE_USER_TYPE) > dht::MAX_VALUE_SIZE) {
+        DPASTE_LOG_ERROR("The data is too large: the list of its %zu parts does not fit in a DHT value.",
+                         p.parts.size());
+        return "";
+    }
 
-    DPASTE_MSG("Pasting data...");
-    auto bin_packet = p.serialize();
-    auto success = http_client_->put(code, {bin_packet.begin(), bin_packet.end()});
-    if (not success)
-        success = node.paste(code, std::move(bin_packet));
+    /* a queued paste is only seen by Bin::flush once complete */
+    const auto spool = Keeper::spool_dir()+'/'+code;
+    if (queue_) {
+        DPASTE_LOG_INFO("Queuing data...");
+        spool_ = std::make_unique<Keeper>(spool+".part");
+    } else
+        DPASTE_LOG_INFO("Pasting data...");
+    /* parts go first so that they are all there once the packet is found */
+    auto success = store_parts(p.parts, std::move(parts), replicas_) and store(code, std::move(packet), replicas_);
+    if (spool_) {
+        spool_.reset();
+        success = success and not std::rename((spool+".part").c_str(), spool.c_str());
+    }
 
     return success ? DPASTE_URI_PREFIX+code+pwd  : "";
 }
 
+size_t Bin::queued() {
+    size_t count {0};
+    Glib::Dir dir {Keeper::spool_dir()};
+    for (auto name = dir.read_name(); not name.empty(); name = dir.read_name())
+        count += name.find('.') == std::string::npos;
+    return count;
+}
+
+bool Bin::flush(const std::atomic_bool* stop) {
+    journal_.reset();
+    const auto spool = Keeper::spool_dir();
+    std::vector<std::string> codes;
+    {
+        Glib::Dir dir {spool};
+        for (auto name = dir.read_name(); not name.empty(); name = dir.read_name())
+            if (name.find('.') == std::string::npos)
+                codes.emplace_back(std::move(name));
+    }
+
+    auto publish = [this, stop](const std::string& path, const std::string& code) {
+        Keeper values {path};
+        auto all = values.next(values.size());
+        using Value = decltype(all)::value_type;
+        /* values under the code itself (and its replicas) go last, like in Bin::publish */
+        const auto header = std::stable_partition(all.begin(), all.end(), [&](const Value& v) {
+            return not (v.first.compare(0, code.size(), code) == 0
+                        and (v.first.size() == code.size() or v.first[code.size()] == '/'));
+        });
+        std::deque<std::future<bool>> pending;
+        bool success {true};
+        auto put = [&](decltype(all)::iterator v) {
+            if (stop and *stop) {
+                success = false;
+                return;
+            }
+            if (pending.size() >= PARTS_IN_FLIGHT) {
+                success = pending.front().get() and success;
+                pending.pop_front();
+            }
+            pending.emplace_back(std::async(std::launch::async, [this, v]() {
+                return store(v->first, std::move(v->second));
+            }));
+        };
+        for (auto v = all.begin(); v != header; ++v)
+            put(v);
+        for (; not pending.empty(); pending.pop_front())
+            success = pending.front().get() and success;
+        if (not success)
+            return false;
+        for (auto v = header; v != all.end(); ++v)
+            put(v);
+        for (; not pending.empty(); pending.pop_front())
+            success = pending.front().get() and success;
+        if (success) {
+            std::remove(path.c_str());
+            DPASTE_LOG_INFO("Published queued paste %s.", code.c_str());
+        }
+        return success;
+    };
+
+    bool success {true};
+    std::deque<std::future<bool>> pending;
+    for (const auto& code : codes) {
+        if (stop and *stop) {
+            success = false;
+            break;
+        }
+        if (pending.size() >= PARTS_IN_FLIGHT) {
+            success = pending.front().get() and success;
+            pending.pop_front();
+        }
+        pending.emplace_back(std::async(std::launch::async, publish, spool+'/'+code, code));
+    }
+    for (auto& f : pending)
+        success = f.get() and success;
+    return success;
+}
+
 msgpack::object*
 findMapValue(msgpack::object& map, const std::string& key) {
     if (map.type != msgpack::type::MAP) throw msgpack::type_error();
@@ -199,18 +1454,120 @@ findMapValue(msgpack::object& map, const std::string& key) {
     return nullptr;
 }
 
+/* lists of digests are packed as a single bin of concatenated digests */
+std::vector<uint8_t>
+pack_digests(const std::vector<crypto::Sha256::Digest>& digests) {
+    std::vector<uint8_t> packed;
+    packed.reserve(digests.size()*crypto::Sha256::DIGEST_SIZE);
+    for (const auto& d : digests)
+        packed.insert(packed.end(), d.begin(), d.end());
+    return packed;
+}
+
+std::vector<crypto::Sha256::Digest>
+unpack_digests(msgpack::object& o) {
+    std::vector<uint8_t> packed;
+    o.convert(packed);
+    if (packed.size() % crypto::Sha256::DIGEST_SIZE)
+        throw msgpack::type_error();
+    std::vector<crypto::Sha256::Digest> digests(packed.size()/crypto::Sha256::DIGEST_SIZE);
+    for (size_t i = 0; i < digests.size(); ++i)
+        std::copy_n(packed.begin()+i*crypto::Sha256::DIGEST_SIZE, crypto::Sha256::DIGEST_SIZE, digests[i].begin());
+    return digests;
+}
+
+crypto::Sha256::Digest Bin::Packet::manifest() const {
+    if (sizes.empty() and files.empty())
+        return root;
+    /* fixed width integers and length prefixed names: no two indexes hash the same input */
+    auto be = [](crypto::Sha256& h, uint64_t v) {
+        std::array<uint8_t, 8> b;
+        for (size_t i = 0; i < b.size(); ++i)
+            b[i] = v >> (56-8*i);
+        h.update(b.data(), b.size());
+    };
+    crypto::Sha256 h;
+    h.update(root.data(), root.size());
+    be(h, sizes.size());
+    for (auto s : sizes)
+        be(h, s);
+    be(h, files.size());
+    for (const auto& f : files) {
+        be(h, f.name.size());
+        h.update(reinterpret_cast<const uint8_t*>(f.name.data()), f.name.size());
+        be(h, f.offset);
+        be(h, f.size);
+    }
+    return h.digest();
+}
+
 std::vector<uint8_t> Bin::Packet::serialize() const {
+    Stats::Span span {"serialize", data.size()};
+    DPASTE_PROBE1(packet_serialize_entry, data.size());
     msgpack::sbuffer buffer;
     msgpack::packer<msgpack::sbuffer> pk(&buffer);
 
-    pk.pack_map(3);
+    if (streamed) {
+        pk.pack_map(6 + not tag.empty());
+        pk.pack("v");      pk.pack(PROTO_VERSION);
+        pk.pack("data");   pk.pack(data);
+        pk.pack("stream"); pk.pack(seq);
+        pk.pack("eof");    pk.pack(eof);
+        pk.pack("scheme"); pk.pack(static_cast<int>(scheme));
+        pk.pack("salt");   pk.pack(salt);
+        if (not tag.empty()) {
+            pk.pack("tag"); pk.pack(tag);
+        }
+        span.bytes_out(buffer.size());
+        DPASTE_PROBE1(packet_serialize_return, buffer.size());
+        return {buffer.data(), buffer.data()+buffer.size()};
+    }
+
+    pk.pack_map((parts.empty() ? 4 : 11 + not chunks.empty() + not sizes.empty() + not files.empty() + (replicas > 1))
+                + not tag.empty());
     pk.pack("v");    pk.pack(PROTO_VERSION);
     pk.pack("data"); pk.pack(data);
     pk.pack("signature"); pk.pack(signature);
+    pk.pack("sighash"); pk.pack(sighash);
+    if (not tag.empty()) {
+        pk.pack("tag"); pk.pack(tag);
+    }
+    if (not parts.empty()) {
+        pk.pack("parts");  pk.pack(pack_digests(parts));
+        pk.pack("root");   pk.pack(std::vector<uint8_t> {root.begin(), root.end()});
+        pk.pack("size");   pk.pack(size);
+        pk.pack("scheme"); pk.pack(static_cast<int>(scheme));
+        pk.pack("salt");   pk.pack(salt);
+        pk.pack("parity"); pk.pack(parity);
+        pk.pack("stripe"); pk.pack(stripe);
+        if (not chunks.empty()) {
+            pk.pack("chunks"); pk.pack(pack_digests(chunks));
+        }
+        if (not sizes.empty()) {
+            pk.pack("sizes"); pk.pack(sizes);
+        }
+        if (replicas > 1) {
+            pk.pack("replicas"); pk.pack(replicas);
+        }
+        if (not files.empty()) {
+            pk.pack("files");
+            pk.pack_array(files.size());
+            for (const auto& f : files) {
+                pk.pack_array(3);
+                pk.pack(f.name);
+                pk.pack(f.offset);
+                pk.pack(f.size);
+            }
+        }
+    }
+    span.bytes_out(buffer.size());
+    DPASTE_PROBE1(packet_serialize_return, buffer.size());
     return {buffer.data(), buffer.data()+buffer.size()};
 }
 
 void Bin::Packet::deserialize(const std::vector<uint8_t>& pbuffer) {
+    Stats::Span span {"deserialize", pbuffer.size()};
+    DPASTE_PROBE1(packet_deserialize_entry, pbuffer.size());
     msgpack::unpacked unpacked = msgpack::unpack(reinterpret_cast<const char*>(pbuffer.data()), pbuffer.size());
     auto msgpack_object = unpacked.get();
 
@@ -220,6 +1577,71 @@ void Bin::Packet::deserialize(const std::vector<uint8_t>& pbuffer) {
     signature.clear();
     if (auto s = findMapValue(msgpack_object, "signature"))
         s->convert(signature);
+    sighash.clear();
+    if (auto h = findMapValue(msgpack_object, "sighash"))
+        h->convert(sighash);
+    tag.clear();
+    if (auto t = findMapValue(msgpack_object, "tag"))
+        t->convert(tag);
+
+    parts.clear();
+    if (auto l = findMapValue(msgpack_object, "parts"))
+        parts = unpack_digests(*l);
+    root.fill(0);
+    if (auto r = findMapValue(msgpack_object, "root")) {
+        std::vector<uint8_t> rv;
+        r->convert(rv);
+        if (rv.size() != root.size())
+            throw msgpack::type_error();
+        std::copy(rv.begin(), rv.end(), root.begin());
+    }
+    size = 0;
+    if (auto sz = findMapValue(msgpack_object, "size"))
+        sz->convert(size);
+    scheme = crypto::Cipher::Scheme::NONE;
+    if (auto sc = findMapValue(msgpack_object, "scheme"))
+        scheme = static_cast<crypto::Cipher::Scheme>(sc->as<int>());
+    salt.clear();
+    if (auto sa = findMapValue(msgpack_object, "salt"))
+        sa->convert(salt);
+    parity = 0;
+    if (auto pa = findMapValue(msgpack_object, "parity"))
+        pa->convert(parity);
+    stripe = 0;
+    if (auto st = findMapValue(msgpack_object, "stripe"))
+        st->convert(stripe);
+    chunks.clear();
+    if (auto ch = findMapValue(msgpack_object, "chunks"))
+        chunks = unpack_digests(*ch);
+    sizes.clear();
+    if (auto sz = findMapValue(msgpack_object, "sizes"))
+        sz->convert(sizes);
+    replicas = 1;
+    if (auto re = findMapValue(msgpack_object, "replicas")) {
+        re->convert(replicas);
+        if (not replicas or replicas > MAX_REPLICAS) throw msgpack::type_error();
+    }
+    streamed = false;
+    seq = 0;
+    if (auto sq = findMapValue(msgpack_object, "stream")) {
+        streamed = true;
+        sq->convert(seq);
+    }
+    eof = false;
+    if (auto e = findMapValue(msgpack_object, "eof"))
+        e->convert(eof);
+    files.clear();
+    if (auto fs = findMapValue(msgpack_object, "files")) {
+        if (fs->type != msgpack::type::ARRAY) throw msgpack::type_error();
+        for (unsigned i = 0; i < fs->via.array.size; ++i) {
+            auto& f = fs->via.array.ptr[i];
+            if (f.type != msgpack::type::ARRAY or f.via.array.size < 3) throw msgpack::type_error();
+            files.push_back({f.via.array.ptr[0].as<std::string>(),
+                             f.via.array.ptr[1].as<uint64_t>(),
+                             f.via.array.ptr[2].as<uint64_t>()});
+        }
+    }
+    DPASTE_PROBE2(packet_deserialize_return, data.size(), parts.size());
 }
 
 } /* dpaste  */
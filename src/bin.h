@@ -21,12 +21,20 @@
 #pragma once
 
 #include <istream>
+#include <ostream>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <cstdint>
 #include <memory>
 #include <map>
 #include <utility>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <limits>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -34,21 +42,35 @@
 #include "node.h"
 #include "http_client.h"
 #include "cipher.h"
+#include "merkle.h"
+#include "journal.h"
+#include "keeper.h"
 
 namespace dpaste {
 #ifdef DPASTE_TEST
 namespace tests { class PirateBinTester; } /* tests */
 #endif
+#ifdef DPASTE_BENCH
+namespace bench { class PirateBinBencher; } /* bench */
+#endif
 
 class Bin {
 #ifdef DPASTE_TEST
     friend class tests::PirateBinTester;
 #endif
+#ifdef DPASTE_BENCH
+    friend class bench::PirateBinBencher;
+#endif
 public:
 
     static const constexpr unsigned int DPASTE_PIN_LEN {8};
 
-    Bin();
+    /**
+     * @param options  Options overriding those of the configuration file (see
+     *                 conf::ConfigurationFile), e.g. {{"bootstrap", ""}} for
+     *                 a DHT network of its own.
+     */
+    explicit Bin(const std::map<std::string, std::string>& options = {});
     virtual ~Bin () {}
 
     /**
@@ -59,7 +81,183 @@ public:
      *
      * @return return code (0: success, 1 fail)
      */
-    std::pair<bool, std::string> get(std::string&& code, bool no_decrypt=false);
+    std::pair<bool, std::string> get(std::string&& code, bool no_decrypt=false) {
+        std::ostringstream oss;
+        auto success = get(std::forward<std::string>(code), oss, no_decrypt);
+        return {success, oss.str()};
+    }
+
+    /**
+     * Execute procedure to get the content stored for a given code and write
+     * it to a stream. Pastes spanning several values are written part by part
+     * as soon as each one is retrieved and verified.
+     *
+     * @param code        The PIN for finding data in DHT.
+     * @param out         The stream to write the content to.
+     * @param no_decrypt  Whether to decrypt the recovered data or not.
+     *
+     * @return true if success, else false.
+     */
+    bool get(std::string&& code, std::ostream& out, bool no_decrypt=false);
+
+    /**
+     * Watch a code: write every value pasted under it, as soon as it is
+     * announced on the DHT. Values already there are written first. Each one
+     * is decoded (and decrypted) like with Bin::get.
+     *
+     * @param code        The PIN for finding data in DHT.
+     * @param out         The stream to write the content to.
+     * @param no_decrypt  Whether to decrypt the recovered data or not.
+     * @param stop        Watching stops once set to true. If null, it never
+     *                    stops.
+     *
+     * @return true if every value could be written, else false.
+     */
+    bool watch(std::string&& code, std::ostream& out, bool no_decrypt=false, const std::atomic_bool* stop = nullptr);
+
+    /**
+     * Stream data as it comes: it is read by lines and stored in values
+     * numbered in sequence, each one sent once STREAM_BATCH_SIZE bytes are
+     * pending or every STREAM_BATCH_DELAY. Values are stored under the code
+     * of the stream, then under codes derived from it (see stream_code).
+     *
+     * @param in       The stream to read, until its end.
+     * @param params   Cryptographic parameters. Only AES is supported: each
+     *                 value is encrypted on its own.
+     * @param on_code  Called with the code (key) to the stream before any
+     *                 data is read.
+     *
+     * @return true if every value was stored, else false.
+     */
+    bool stream(std::istream& in, std::unique_ptr<crypto::Parameters>&& params,
+                const std::function<void(const std::string&)>& on_code);
+
+    /**
+     * Follow a stream: write the data of its values in order, as soon as they
+     * are announced, until its end.
+     *
+     * @param code  The code of the stream.
+     * @param out   The stream to write the content to.
+     * @param stop  Following stops once set to true. If null, it only stops
+     *              at the end of the stream.
+     *
+     * @return true if success, else false.
+     */
+    bool follow(std::string&& code, std::ostream& out, const std::atomic_bool* stop = nullptr);
+
+    /**
+     * Keep the pastes alive: republish every value kept (see set_keep()) once
+     * every REFRESH_PERIOD, before it expires. Values are put in batches of
+     * REFRESH_BATCH_SIZE spread evenly over the period, and no faster than
+     * REFRESH_MAX_RATE values per second, so that the traffic stays flat
+     * however many pastes are kept.
+     *
+     * @param stop  Refreshing stops once set to true. If null, it never
+     *              stops.
+     *
+     * @return true if every value was republished, else false.
+     */
+    bool refresh(const std::atomic_bool* stop = nullptr);
+
+    /**
+     * Stop keeping a paste alive: its values are removed from the local store
+     * of Bin::refresh (see set_keep()). Parts shared with another paste kept
+     * stay kept.
+     *
+     * @param code  The code of the paste.
+     *
+     * @return true if values were kept for the paste, else false.
+     */
+    bool unkeep(std::string&& code);
+
+    /**
+     * Publish the pastes queued (see set_queue()), several at once. A paste
+     * is removed from the spool once all its values were stored.
+     *
+     * @param stop  No value is put anymore once set to true: the pastes not
+     *              published whole stay queued. If null, it never stops.
+     *
+     * @return true if every queued paste was published, else false.
+     */
+    bool flush(const std::atomic_bool* stop = nullptr);
+
+    /**
+     * @return the number of pastes queued and not yet published.
+     */
+    static size_t queued();
+
+    /**
+     * @return whether a value was stored on the network or received from it
+     *         by this Bin, i.e. whether the network was reached. A get which
+     *         found nothing does not tell.
+     */
+    bool reached_network() const { return reached_network_; }
+
+    /**
+     * Get a member of an archive paste, or a range of bytes of any paste. Only
+     * the values covering the requested bytes are retrieved.
+     *
+     * @param code    The PIN for finding data in DHT.
+     * @param out     The stream to write the content to.
+     * @param name    The name of the archive member. If empty, the range is
+     *                taken from the whole content.
+     * @param offset  The offset of the range (from the start of the member).
+     * @param length  The length of the range.
+     *
+     * @return true if success, else false.
+     */
+    bool extract(std::string&& code, std::ostream& out, const std::string& name,
+                 uint64_t offset = 0, uint64_t length = std::numeric_limits<uint64_t>::max());
+
+    /**
+     * Set the number of parity values computed for every STRIPE_SIZE parts of
+     * data spanning several values. Any STRIPE_SIZE values out of a stripe are
+     * then enough to recover it. Defaults to the "parity" configuration
+     * option.
+     *
+     * @param parity  The number of parity values per stripe.
+     */
+    void set_parity(unsigned parity);
+
+    /**
+     * Pastes and gets spanning several values keep a journal of the values
+     * stored or received so far. When resuming, the journal left by an
+     * interrupted run on the same data (or code) is used to skip the values
+     * already transferred.
+     *
+     * @param resume  Whether to resume from the journal.
+     */
+    void set_resume(bool resume) { resume_ = resume; }
+
+    /**
+     * Keep every value stored from now on in the local store of Bin::refresh
+     * ($XDG_DATA_HOME/dpaste/kept), for the pastes to outlive the expiration
+     * of DHT values.
+     *
+     * @param keep  Whether to keep the values stored.
+     */
+    void set_keep(bool keep) { keeper_ = keep ? std::make_unique<Keeper>(Keeper::path()) : nullptr; }
+
+    /**
+     * Queue pastes instead of publishing them: their code is returned right
+     * away, without reaching the network, and their values are saved in the
+     * spool directory ($XDG_DATA_HOME/dpaste/spool) until Bin::flush.
+     *
+     * @param queue  Whether to queue pastes.
+     */
+    void set_queue(bool queue) { queue_ = queue; }
+
+    /**
+     * Set the number of replicas of pasted values. Every value is stored under
+     * as many codes derived from its own (see Node::replica_code()) so that
+     * reading a paste fetched by many at once is spread over the DHT. Gets
+     * look the code up in as many replicas, starting with one at random,
+     * while the parts of a paste are looked up in the replicas it was pasted
+     * with. Defaults to the "replicas" configuration option.
+     *
+     * @param replicas  The number of replicas, at most MAX_REPLICAS.
+     */
+    void set_replicas(unsigned replicas) { replicas_ = std::max(1u, std::min(replicas, MAX_REPLICAS)); }
 
     /**
      * Execute procedure to publish content and generate the associated code.
@@ -75,14 +273,168 @@ public:
                 std::forward<std::unique_ptr<crypto::Parameters>>(params));
     }
 
+    /**
+     * Publish a new version of a paste. Parts of the previous version which
+     * are left unchanged by the edit and still found on the DHT are not
+     * stored again. The previous paste must have been encrypted the same way
+     * (AES with the same password, or not at all) for its parts to be reused.
+     * Otherwise, the data is pasted anew.
+     *
+     * @param code    The code of the previous version.
+     * @param data    Data to be pasted.
+     * @param params  Cryptographic parameters.
+     *
+     * @return the code (key) to the new version. If empty, then process
+     *         failed.
+     */
+    std::string update(std::string&& code, std::vector<uint8_t>&& data, std::unique_ptr<crypto::Parameters>&& params);
+    std::string update(std::string&& code, std::stringstream&& input_stream,
+                       std::unique_ptr<crypto::Parameters>&& params)
+    {
+        return update(std::forward<std::string>(code), data_from_stream(std::move(input_stream)),
+                std::forward<std::unique_ptr<crypto::Parameters>>(params));
+    }
+
+    /**
+     * Publish several files as one archive paste. The names, sizes and
+     * offsets of the files are kept in the value found under the code so
+     * that a single file can be extracted (see Bin::extract). Getting the
+     * whole paste lists the files.
+     *
+     * @param files   The name and content of each file, in order.
+     * @param params  Cryptographic parameters.
+     *
+     * @return the code (key) to the pasted data. If empty, then process failed.
+     */
+    std::string paste(std::vector<std::pair<std::string, std::vector<uint8_t>>>&& files,
+                      std::unique_ptr<crypto::Parameters>&& params);
+
 private:
     /* constants */
     static const constexpr char* DPASTE_URI_PREFIX = "dpaste:";
-    static const constexpr uint8_t PROTO_VERSION = 0;
+    static const constexpr uint8_t PROTO_VERSION = 1;
+    /**
+     * Data larger than this is split in parts, each one stored in its own
+     * value. It leaves room for GPG armor to fit in a single value.
+     */
+    static const constexpr size_t PART_SIZE {40*1024};
+    /* maximum number of parts being transferred at once */
+    static const constexpr size_t PARTS_IN_FLIGHT {8};
+    /* number of times retrieving a part is attempted */
+    static const constexpr unsigned PART_FETCH_ATTEMPTS {3};
+    /* number of data parts covered by each group of parity parts */
+    static const constexpr size_t STRIPE_SIZE {16};
+    /**
+     * Bounds of the content-defined chunks data is split in when no parity is
+     * computed. The maximum is PART_SIZE.
+     */
+    static const constexpr size_t CHUNK_MIN_SIZE {4*1024};
+    static const constexpr size_t CHUNK_AVG_SIZE {16*1024};
+    /**
+     * Time given to the HTTP proxy before the DHT node is started in the
+     * background, so that it is ready if the proxy ends up failing.
+     */
+    static const constexpr std::chrono::milliseconds NODE_HEDGE_DELAY {300};
+    /* how often Bin::watch and Bin::follow check whether they should stop */
+    static const constexpr std::chrono::milliseconds WATCH_POLL_PERIOD {100};
+    /* live streams are sent in values of at most this size, or this often */
+    static const constexpr size_t STREAM_BATCH_SIZE {16*1024};
+    static const constexpr std::chrono::milliseconds STREAM_BATCH_DELAY {200};
+    /* number of values of a stream stored under the same code */
+    static const constexpr uint64_t STREAM_SEGMENT_SIZE {64};
+    /* time after which a missing value of a stream is given up on */
+    static const constexpr std::chrono::seconds STREAM_GAP_TIMEOUT {10};
+    /* kept values are republished this often, before nodes drop them (see Node::VALUE_EXPIRATION) */
+    static const constexpr std::chrono::minutes REFRESH_PERIOD {8};
+    static const constexpr size_t REFRESH_BATCH_SIZE {16};
+    static const constexpr double REFRESH_MAX_RATE {50};
+    /* how often the store is checked for new values when none is kept */
+    static const constexpr std::chrono::seconds REFRESH_IDLE_DELAY {10};
+
+    static const constexpr unsigned MAX_REPLICAS {16};
+
+    /* length of Packet::tag */
+    static const constexpr size_t TAG_LEN {8};
+
+    /* hash functions used to build the signed manifest */
+    static const constexpr char* SIGNED_HASH = "sha256";
+    static const constexpr char* MERKLE_HASH = "merkle-sha256";
+    /* the root along with the index (Packet::sizes and Packet::files) */
+    static const constexpr char* MERKLE_INDEX_HASH = "merkle-sha256-index";
 
     struct Packet {
         std::vector<uint8_t> data {};
         std::vector<uint8_t> signature {};
+        /* If not empty, signature is detached and covers signed_manifest() of
+         * either the data (SIGNED_HASH) or manifest() (MERKLE_HASH or
+         * MERKLE_INDEX_HASH). */
+        std::string sighash {};
+
+        /*
+         * For data larger than PART_SIZE, the packet holds no data. Each part
+         * is stored under the hexadecimal representation of its Merkle leaf
+         * hash, listed here in order.
+         */
+        std::vector<crypto::Merkle::Digest> parts {};
+        crypto::Merkle::Digest root {};
+        /* size of the data split in parts (the cipher text in case of GPG) */
+        uint64_t size {0};
+        crypto::Cipher::Scheme scheme {crypto::Cipher::Scheme::NONE};
+        /* AES parts are encrypted with a key derived once from this salt */
+        std::vector<uint8_t> salt {};
+        /*
+         * If parity is not zero, parts are grouped in stripes of `stripe` data
+         * parts (padded to PART_SIZE) followed by `parity` Reed-Solomon parity
+         * parts. The last stripe may hold fewer data parts.
+         */
+        uint32_t parity {0};
+        uint32_t stripe {0};
+        /*
+         * AES parts only: keyed hash of the plain text of each part, so that
+         * an update can tell which parts it can reuse.
+         */
+        std::vector<crypto::Merkle::Digest> chunks {};
+        /*
+         * Size of the plain text of each data part, if cut by the Chunker.
+         * Otherwise, every data part but the last holds PART_SIZE bytes.
+         */
+        std::vector<uint32_t> sizes {};
+
+        /* archive pastes: files at the given offset of the data, in order */
+        struct File {
+            std::string name;
+            uint64_t offset;
+            uint64_t size;
+        };
+        std::vector<File> files {};
+
+        /* number of replicas of every part (see set_replicas()) */
+        uint32_t replicas {1};
+
+        /*
+         * Values of a live stream hold data of their own (encrypted with a
+         * key derived from the salt, if scheme is AES) and their position in
+         * the stream.
+         */
+        bool streamed {false};
+        uint64_t seq {0};
+        bool eof {false};
+
+        /*
+         * Keyed hash of the code (see code_tag()). Values stored under the
+         * same location code by other pastes are told apart with it before
+         * any decryption. Empty for values pasted by older versions.
+         */
+        std::vector<uint8_t> tag {};
+
+        /**
+         * The digest covered by the signature of data split in parts: the
+         * root, or a digest of the root and the index if there is one.
+         */
+        crypto::Sha256::Digest manifest() const;
+        const char* manifest_hash() const {
+            return sizes.empty() and files.empty() ? MERKLE_HASH : MERKLE_INDEX_HASH;
+        }
 
         std::vector<uint8_t> serialize() const;
         void deserialize(const std::vector<uint8_t>& pbuffer);
@@ -99,6 +451,149 @@ private:
      */
     std::pair<Bin::Packet, std::string> prepare_data(std::vector<uint8_t>&& data, std::unique_ptr<crypto::Parameters>&& params);
 
+    /**
+     * Split input data in parts and create the Packet describing them. AES
+     * encrypts each part on its own so that they can be decrypted as they
+     * come. GPG encrypts the whole data before it is split.
+     *
+     * Unless parity is computed or GPG encrypts the data, parts are cut at
+     * content-defined boundaries (see Chunker) so that an edit leaves most of
+     * them unchanged.
+     *
+     * @param data      input data in bytes.
+     * @param params    cryptographic parameters (either GPGParameters or
+     *                  AESParameters).
+     * @param parts     where to put the parts, in order. Parts reused from
+     *                  the base are left empty.
+     * @param base      The Packet of a previous version whose parts are
+     *                  reused when found on the DHT.
+     * @param base_pwd  The password of the previous version.
+     * @param files     The index of an archive paste.
+     *
+     * @return an ordered pair of a Packet and associated password.
+     */
+    std::pair<Bin::Packet, std::string> prepare_parts(std::vector<uint8_t>&& data,
+                                                      std::unique_ptr<crypto::Parameters>&& params,
+                                                      std::vector<std::vector<uint8_t>>& parts,
+                                                      const Packet* base = nullptr,
+                                                      const std::string& base_pwd = "",
+                                                      std::vector<Packet::File>&& files = {});
+
+    /**
+     * Paste data, in several values if larger than PART_SIZE or if it is an
+     * archive.
+     *
+     * @param data    Data to be pasted.
+     * @param params  Cryptographic parameters.
+     * @param files   The index of an archive paste.
+     *
+     * @return the code (key) to the pasted data. If empty, then process failed.
+     */
+    std::string paste(std::vector<uint8_t>&& data, std::unique_ptr<crypto::Parameters>&& params,
+                      std::vector<Packet::File>&& files);
+
+    /**
+     * Store the parts, then the Packet.
+     *
+     * @param pp     The Packet and its password.
+     * @param parts  The parts. Empty ones are already stored.
+     * @param code   The location code to store the Packet under.
+     *
+     * @return the code (key) to the pasted data. If empty, then process failed.
+     */
+    std::string publish(std::pair<Packet, std::string>&& pp, std::vector<std::vector<uint8_t>>&& parts,
+                        const std::string& code);
+
+    /**
+     * Retrieve, verify and write the parts described by a Packet. Only the
+     * parts covering the requested range are retrieved, except for GPG which
+     * can only decrypt the whole data.
+     *
+     * @param p           The packet.
+     * @param pwd         The password part of the code.
+     * @param out         The stream to write the content to.
+     * @param no_decrypt  Whether to decrypt the recovered data or not.
+     * @param offset      The offset of the range of data to write.
+     * @param length      The length of the range of data to write.
+     *
+     * @return true if success, else false.
+     */
+    bool get_parts(const Packet& p, const std::string& pwd, std::ostream& out, bool no_decrypt,
+                   uint64_t offset = 0, uint64_t length = std::numeric_limits<uint64_t>::max());
+
+    /**
+     * Decode a value found under a code and write its content: the data of a
+     * single value, the parts it lists or the files of an archive.
+     *
+     * @param data        The value.
+     * @param code        The full code (with the password, if any).
+     * @param out         The stream to write the content to.
+     * @param no_decrypt  Whether to decrypt the recovered data or not.
+     *
+     * @return true if success, else false.
+     */
+    bool write_value(std::vector<uint8_t>&& data, const std::string& code, std::ostream& out, bool no_decrypt);
+
+    /**
+     * Code under which a segment of STREAM_SEGMENT_SIZE values of a stream is
+     * stored. The first one is stored under the code of the stream.
+     *
+     * @param lcode    The location code of the stream.
+     * @param segment  The index of the segment.
+     */
+    static std::string stream_code(const std::string& lcode, uint64_t segment);
+
+    /**
+     * @param code  The code, password included, without the URI prefix.
+     *
+     * @return the tag of the values pasted under this code (see Packet::tag).
+     */
+    static std::vector<uint8_t> code_tag(const std::string& code);
+
+    /**
+     * @return false if the value is tagged for another code than this one.
+     */
+    static bool tagged_for(const Packet& p, const std::string& code) {
+        return p.tag.empty() or p.tag == code_tag(code);
+    }
+    static bool tagged_for(const std::vector<uint8_t>& value, const std::string& code);
+
+    /**
+     * Get the data of a value of a stream.
+     *
+     * @param p       The value.
+     * @param pwd     The password part of the code.
+     * @param params  The key of the stream. Derived from the salt of the value
+     *                if null.
+     *
+     * @return the data.
+     */
+    static std::vector<uint8_t> stream_data(const Packet& p, const std::string& pwd,
+                                            std::shared_ptr<crypto::Parameters>& params);
+
+    /**
+     * Check a Packet describing parts: its root, its layout and its
+     * signature, if any.
+     *
+     * @param p  The packet.
+     *
+     * @return true if the header can be trusted, else false.
+     */
+    bool check_header(const Packet& p);
+
+    /**
+     * Build the message signed in place of the data: the name of the hash
+     * function followed by a digest. Signing it costs the same whatever the
+     * size of the data.
+     *
+     * @param hash    The name of the hash function (SIGNED_HASH or
+     *                MERKLE_HASH).
+     * @param digest  The digest covering the data.
+     *
+     * @return the manifest.
+     */
+    static std::vector<uint8_t> signed_manifest(const std::string& hash, const crypto::Sha256::Digest& digest);
+
     /**
      * Get data from input stream.
      *
@@ -119,11 +614,127 @@ private:
 
     static std::string random_pin();
 
+    /**
+     * Start the DHT node, if not already, and join the network given by the
+     * "bootstrap" option.
+     */
+    void run_node();
+
+    /**
+     * Wait for the result of a request made to the HTTP proxy. The DHT node
+     * is started in the background if the request takes longer than
+     * NODE_HEDGE_DELAY.
+     *
+     * @param request  The pending proxy request.
+     *
+     * @return the result of the request.
+     */
+    template <typename T>
+    T await_proxy(std::future<T>&& request);
+
+    /**
+     * Retrieve a value from the HTTP proxy, or from the DHT on failure.
+     *
+     * @param code      The location code.
+     * @param accept    Tells whether a value is the one looked for. If empty,
+     *                  any value is accepted.
+     * @param cancel    If set to true, the DHT is not queried. It is checked
+     *                  once the proxy request completes: a value accepted
+     *                  from the proxy is still returned, and a DHT lookup
+     *                  already started runs to its end.
+     * @param replicas  The number of replicas to look the code up in.
+     *
+     * @return the first accepted value. Empty on failure or if cancelled.
+     */
+    std::vector<uint8_t> fetch(const std::string& code,
+                               const std::function<bool(const std::vector<uint8_t>&)>& accept = {},
+                               const std::atomic_bool* cancel = nullptr,
+                               unsigned replicas = 1);
+
+    /**
+     * Retrieve a part and check it against its leaf hash.
+     *
+     * @param leaf      The leaf hash of the part.
+     * @param cancel    If set to true, no further attempt is made.
+     * @param replicas  The number of replicas of the part.
+     *
+     * @return the part. Empty on failure.
+     */
+    std::vector<uint8_t> fetch_part(const crypto::Merkle::Digest& leaf, const std::atomic_bool* cancel = nullptr,
+                                    unsigned replicas = 1);
+
+    /**
+     * Retrieve the data parts of an erasure coded stripe. Every part of the
+     * stripe is looked up at once and the lookups still pending are cancelled
+     * as soon as k of them succeeded.
+     *
+     * @param leaves      The leaf hashes of the data then parity parts.
+     * @param k           The number of data parts.
+     * @param stragglers  Where to put the lookups that may still be running.
+     * @param replicas    The number of replicas of the parts.
+     *
+     * @return the k data parts. Empty on failure.
+     */
+    std::vector<std::vector<uint8_t>> fetch_stripe(const std::vector<crypto::Merkle::Digest>& leaves, size_t k,
+                                                   std::vector<std::future<void>>& stragglers,
+                                                   unsigned replicas = 1);
+
+    /**
+     * Tell which parts can still be retrieved. If a journal is in use, it is
+     * trusted instead of looking the parts up.
+     *
+     * @param leaves  The leaf hashes of the parts.
+     *
+     * @return whether each part was found.
+     */
+    std::vector<bool> find_parts(const std::vector<crypto::Merkle::Digest>& leaves);
+
+    /**
+     * Store a value through the HTTP proxy, or on the DHT on failure.
+     *
+     * @param code      The location code.
+     * @param blob      The value.
+     * @param replicas  The number of replicas to store.
+     *
+     * @return true if success, else false.
+     */
+    bool store(const std::string& code, std::vector<uint8_t>&& blob, unsigned replicas = 1);
+
+    /**
+     * Store parts concurrently (at most PARTS_IN_FLIGHT at once). Empty parts
+     * are skipped.
+     *
+     * @param leaves    The leaf hashes of the parts.
+     * @param parts     The parts.
+     * @param replicas  The number of replicas of every part.
+     *
+     * @return true if every part was stored, else false.
+     */
+    bool store_parts(const std::vector<crypto::Merkle::Digest>& leaves, std::vector<std::vector<uint8_t>>&& parts,
+                     unsigned replicas = 1);
+
     std::map<std::string, std::string> conf_;
+    unsigned parity_ {0};
+    unsigned replicas_ {1};
+    bool resume_ {false};
+    /* journal of the paste or get in progress, if it spans several values */
+    std::unique_ptr<Journal> journal_ {};
+    /* store of the values to republish, if they are kept */
+    std::unique_ptr<Keeper> keeper_ {};
+    bool queue_ {false};
+    /* spool of the paste being queued */
+    std::unique_ptr<Keeper> spool_ {};
+    std::atomic_bool reached_network_ {false};
 
     /* transport */
     std::unique_ptr<HttpClient> http_client_ {};
+    /* The DHT node is only started on proxy failure or at the hedge deadline */
     Node node {};
+    /* node to join the DHT with ("bootstrap" option: host[:port]), if any */
+    std::string bootstrap_host_ {};
+    std::string bootstrap_port_ {};
+    std::mutex node_start_mtx_ {};
+    std::future<void> node_start_ {};
 };
 
 } /* dpaste */
@@ -0,0 +1,100 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+
+#include "chunker.h"
+
+namespace dpaste {
+
+namespace {
+
+/* splitmix64, only used to fill the gear table deterministically */
+std::array<uint64_t, 256> make_gear() {
+    std::array<uint64_t, 256> gear;
+    uint64_t x = 0x6470617374652121; /* "dpaste!!" */
+    for (auto& g : gear) {
+        uint64_t z = (x += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        g = z ^ (z >> 31);
+    }
+    return gear;
+}
+
+const std::array<uint64_t, 256>& gear() {
+    static const auto g = make_gear();
+    return g;
+}
+
+/* mask with the n most significant bits set */
+uint64_t top_bits(unsigned n) {
+    return n ? ~uint64_t(0) << (64-n) : 0;
+}
+
+} /* anonymous */
+
+Chunker::Chunker(size_t min_size, size_t avg_size, size_t max_size)
+    : min_(min_size), avg_(avg_size), max_(max_size)
+{
+    if (not avg_ or (avg_ & (avg_-1)) or min_ > avg_ or avg_ > max_)
+        throw std::invalid_argument("invalid chunk sizes");
+    unsigned bits = 0;
+    while ((size_t(1) << bits) < avg_)
+        ++bits;
+    mask_small_ = top_bits(bits+2);
+    mask_large_ = top_bits(bits > 2 ? bits-2 : 0);
+}
+
+size_t Chunker::cut(const uint8_t* data, size_t size) const {
+    if (size <= min_)
+        return size;
+    const auto& g = gear();
+    const auto end = std::min(size, max_);
+    const auto normal = std::min(end, avg_);
+    uint64_t h = 0;
+    size_t i = min_;
+    for (; i < normal; ++i) {
+        h = (h << 1) + g[data[i]];
+        if (not (h & mask_small_))
+            return i+1;
+    }
+    for (; i < end; ++i) {
+        h = (h << 1) + g[data[i]];
+        if (not (h & mask_large_))
+            return i+1;
+    }
+    return end;
+}
+
+std::vector<size_t> Chunker::split(const std::vector<uint8_t>& data) const {
+    std::vector<size_t> ends;
+    for (size_t offset = 0; offset < data.size();) {
+        offset += cut(data.data()+offset, data.size()-offset);
+        ends.push_back(offset);
+    }
+    return ends;
+}
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
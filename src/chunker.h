@@ -0,0 +1,77 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace dpaste {
+
+/**
+ * Content-defined chunker (FastCDC). Chunk boundaries are picked with a gear
+ * rolling hash over the data itself, so that an edit only changes the chunks
+ * around it instead of shifting every chunk after it.
+ *
+ * The gear table is generated from a fixed seed: boundaries must stay the
+ * same from one version of dpaste to the other for chunks to be reused.
+ */
+class Chunker {
+public:
+    /**
+     * @param min_size  Minimum size of a chunk (except for the last one).
+     * @param avg_size  Expected size of a chunk. Must be a power of two.
+     * @param max_size  Maximum size of a chunk.
+     */
+    Chunker(size_t min_size, size_t avg_size, size_t max_size);
+    virtual ~Chunker () {}
+
+    /**
+     * Find the end of the first chunk of some data.
+     *
+     * @param data  The data.
+     * @param size  The size of the data.
+     *
+     * @return the size of the chunk.
+     */
+    size_t cut(const uint8_t* data, size_t size) const;
+
+    /**
+     * Split data in chunks.
+     *
+     * @param data  The data.
+     *
+     * @return the end offset of each chunk, in order.
+     */
+    std::vector<size_t> split(const std::vector<uint8_t>& data) const;
+
+private:
+    size_t min_;
+    size_t avg_;
+    size_t max_;
+    /* more bits before avg_ (harder to match), less after (easier) */
+    uint64_t mask_small_;
+    uint64_t mask_large_;
+};
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
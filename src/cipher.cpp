@@ -26,12 +26,7 @@ namespace dpaste {
 namespace crypto {
 
 void Cipher::init() {
-    static bool initialized = false;
-    if (initialized) return;
-
     GPG::init();
-
-    initialized = true;
 }
 
 std::shared_ptr<Cipher> Cipher::get(const std::vector<uint8_t>& cipher_text, const std::string& pin="") {
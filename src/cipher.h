@@ -40,6 +40,11 @@ public:
 
     virtual ~Cipher () {}
 
+    /**
+     * Eagerly initialize every cipher backend. This is optional: backends
+     * initialize themselves on first use (see GPG::init). Calling this is only
+     * useful to make engine failures show up early.
+     */
     static void init();
 
     /**
@@ -89,8 +94,8 @@ struct GPGParameters {
 
     std::string key_id;
     std::vector<std::string> recipients;
-    bool self_recipient;
-    bool sign;
+    bool self_recipient {false};
+    bool sign {false};
 
     GPGParameters() {}
     GPGParameters(std::string key_id) : key_id(key_id) {}
@@ -101,9 +106,12 @@ struct GPGParameters {
 struct AESParameters {
     const static Cipher::Scheme scheme = Cipher::Scheme::AES;
     std::string password;
+    /* If not empty, used instead of the password (see AES::deriveKey) */
+    std::vector<uint8_t> key;
 
     AESParameters() {}
     AESParameters(std::string password) : password(password) {}
+    AESParameters(std::vector<uint8_t> key) : key(key) {}
 };
 
 } /* crypto */
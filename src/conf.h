@@ -40,7 +40,10 @@ public:
         config_({
                     {"host",       "127.0.0.1"},
                     {"port",       "6509"     },
-                    {"pgp_key_id", ""         }
+                    {"pgp_key_id", ""         },
+                    {"parity",     "0"        },
+                    {"replicas",   "1"        },
+                    {"bootstrap",  "bootstrap.ring.cx:4222"}
                 })
     {
         if (file_path.empty()) {
@@ -0,0 +1,161 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <array>
+#include <stdexcept>
+
+#include "erasure.h"
+
+namespace dpaste {
+
+const constexpr size_t ReedSolomon::MAX_SHARDS;
+
+namespace {
+
+/* GF(2^8) arithmetic with the 0x11d polynomial */
+struct GF256 {
+    std::array<uint8_t, 512> exp;
+    std::array<uint8_t, 256> log;
+
+    GF256() {
+        unsigned x = 1;
+        for (unsigned i = 0; i < 255; ++i) {
+            exp[i] = x;
+            log[x] = i;
+            x <<= 1;
+            if (x & 0x100)
+                x ^= 0x11d;
+        }
+        for (unsigned i = 255; i < exp.size(); ++i)
+            exp[i] = exp[i-255];
+        log[0] = 0;
+    }
+
+    uint8_t mul(uint8_t a, uint8_t b) const {
+        return a and b ? exp[log[a]+log[b]] : 0;
+    }
+    uint8_t inv(uint8_t a) const {
+        return exp[255-log[a]];
+    }
+    /* y ^= c*x over a whole buffer */
+    void mul_add(uint8_t* y, const uint8_t* x, uint8_t c, size_t len) const {
+        if (not c)
+            return;
+        const auto lc = log[c];
+        for (size_t i = 0; i < len; ++i)
+            if (x[i])
+                y[i] ^= exp[lc+log[x[i]]];
+    }
+};
+
+const GF256& gf() {
+    static const GF256 f;
+    return f;
+}
+
+} /* anonymous */
+
+ReedSolomon::ReedSolomon(size_t data_shards, size_t parity_shards) : k_(data_shards), m_(parity_shards) {
+    if (not k_ or k_+m_ > MAX_SHARDS)
+        throw std::invalid_argument("invalid number of shards");
+}
+
+/* Cauchy matrix: 1/(x_i + y_j) with x_i = k+i and y_j = j, all distinct. */
+uint8_t ReedSolomon::coefficient(size_t parity_row, size_t data_col) const {
+    return gf().inv(static_cast<uint8_t>((k_+parity_row) ^ data_col));
+}
+
+std::vector<std::vector<uint8_t>> ReedSolomon::encode(const std::vector<std::vector<uint8_t>>& data) const {
+    if (data.size() != k_)
+        throw std::invalid_argument("wrong number of data shards");
+    const auto len = data.front().size();
+    std::vector<std::vector<uint8_t>> parity (m_, std::vector<uint8_t>(len));
+    for (size_t i = 0; i < m_; ++i)
+        for (size_t j = 0; j < k_; ++j)
+            gf().mul_add(parity[i].data(), data[j].data(), coefficient(i, j), len);
+    return parity;
+}
+
+bool ReedSolomon::reconstruct(std::vector<std::vector<uint8_t>>& shards) const {
+    if (shards.size() != k_+m_)
+        throw std::invalid_argument("wrong number of shards");
+
+    std::vector<size_t> missing, present;
+    for (size_t j = 0; j < k_; ++j)
+        if (shards[j].empty())
+            missing.push_back(j);
+    if (missing.empty())
+        return true;
+    for (size_t i = 0; i < k_+m_ and present.size() < k_; ++i)
+        if (not shards[i].empty())
+            present.push_back(i);
+    if (present.size() < k_)
+        return false;
+    const auto len = shards[present.front()].size();
+
+    /* rows of the generator matrix for the shards we have */
+    std::vector<std::vector<uint8_t>> a (k_, std::vector<uint8_t>(k_));
+    for (size_t r = 0; r < k_; ++r) {
+        const auto row = present[r];
+        for (size_t c = 0; c < k_; ++c)
+            a[r][c] = row < k_ ? row == c : coefficient(row-k_, c);
+    }
+
+    /* invert it (Gauss-Jordan) */
+    std::vector<std::vector<uint8_t>> inv (k_, std::vector<uint8_t>(k_));
+    for (size_t i = 0; i < k_; ++i)
+        inv[i][i] = 1;
+    for (size_t c = 0; c < k_; ++c) {
+        size_t p = c;
+        while (p < k_ and not a[p][c])
+            ++p;
+        if (p == k_)
+            return false;
+        std::swap(a[c], a[p]);
+        std::swap(inv[c], inv[p]);
+        const auto f = gf().inv(a[c][c]);
+        for (size_t j = 0; j < k_; ++j) {
+            a[c][j] = gf().mul(a[c][j], f);
+            inv[c][j] = gf().mul(inv[c][j], f);
+        }
+        for (size_t r = 0; r < k_; ++r) {
+            if (r == c or not a[r][c])
+                continue;
+            const auto g = a[r][c];
+            for (size_t j = 0; j < k_; ++j) {
+                a[r][j] ^= gf().mul(g, a[c][j]);
+                inv[r][j] ^= gf().mul(g, inv[c][j]);
+            }
+        }
+    }
+
+    /* data shard j is row j of the inverse applied to the present shards */
+    for (auto j : missing) {
+        std::vector<uint8_t> shard (len);
+        for (size_t r = 0; r < k_; ++r)
+            gf().mul_add(shard.data(), shards[present[r]].data(), inv[j][r], len);
+        shards[j] = std::move(shard);
+    }
+    return true;
+}
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
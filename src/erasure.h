@@ -0,0 +1,70 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace dpaste {
+
+/**
+ * Systematic Reed-Solomon erasure code over GF(2^8). The k data shards are
+ * kept as is and m parity shards are computed from a Cauchy matrix, so that
+ * any k shards out of k+m are enough to recover the data. Shards must all be
+ * of the same length and k+m can't exceed 256.
+ */
+class ReedSolomon {
+public:
+    static const constexpr size_t MAX_SHARDS {256};
+
+    ReedSolomon(size_t data_shards, size_t parity_shards);
+    virtual ~ReedSolomon () {}
+
+    /**
+     * Compute parity shards.
+     *
+     * @param data  The k data shards.
+     *
+     * @return the m parity shards.
+     */
+    std::vector<std::vector<uint8_t>> encode(const std::vector<std::vector<uint8_t>>& data) const;
+
+    /**
+     * Recover missing data shards in place.
+     *
+     * @param shards  The k+m shards (data first). Missing ones are empty.
+     *
+     * @return true if the data shards could be recovered, false if fewer than
+     *         k shards are present.
+     */
+    bool reconstruct(std::vector<std::vector<uint8_t>>& shards) const;
+
+private:
+    uint8_t coefficient(size_t parity_row, size_t data_col) const;
+
+    size_t k_;
+    size_t m_;
+};
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
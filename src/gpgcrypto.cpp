@@ -20,7 +20,10 @@
 
 #include <iostream>
 #include <array>
+#include <algorithm>
 #include <sstream>
+#include <mutex>
+#include <cstring>
 
 #include <gpgme++/key.h>
 #include <gpgme++/data.h>
@@ -28,12 +31,26 @@
 
 #include "log.h"
 #include "gpgcrypto.h"
+#include "stats.h"
+#include "trace.h"
+#include "metrics.h"
+#include "probes.h"
 
 static constexpr const size_t BUFLEN = 1024;
+static constexpr const char* PGP_ARMOR_HEADER = "-----BEGIN PGP MESSAGE-----";
 
 namespace dpaste {
 namespace crypto {
 
+namespace {
+
+const Metrics::Histogram& crypto_seconds(const char* op) {
+    return Metrics::histogram("dpaste_crypto_seconds", "Time spent encrypting and decrypting, by scheme.",
+                              std::string("scheme=\"gpg\",op=\"")+op+"\"");
+}
+
+} /* anonymous namespace */
+
 std::vector<uint8_t> dataToVector(GpgME::Data& d) {
     d.seek(0, SEEK_SET);
     std::array<uint8_t, BUFLEN> buf;
@@ -45,7 +62,8 @@ std::vector<uint8_t> dataToVector(GpgME::Data& d) {
     return v;
 }
 
-GPG::GPG(std::string signer) : ctx(GpgME::Context::createForProtocol(GpgME::Protocol::OpenPGP)), signerKey_(signer) {
+GPG::GPG(std::string signer) : signerKey_(signer) {
+    init();
     ctx = std::unique_ptr<GpgME::Context>(GpgME::Context::createForProtocol(GpgME::Protocol::OpenPGP));
     ctx->setArmor(1);
     if (not signer.empty())
@@ -53,21 +71,24 @@ GPG::GPG(std::string signer) : ctx(GpgME::Context::createForProtocol(GpgME::Prot
 }
 
 void GPG::init() {
-    static bool initialized = false;
-    if (initialized) return;
-
-    GpgME::initializeLibrary();
-    auto err = GpgME::checkEngine(GpgME::Protocol::OpenPGP);
-    if (err.code() != GPG_ERR_NO_ERROR)
-        throw GpgME::Exception(err, "Failed to initialize OpenPGP engine");
-
-    initialized = true;
+    /* If checkEngine throws, the flag is left unset and the next call retries. */
+    static std::once_flag initialized;
+    std::call_once(initialized, []() {
+        Stats::Span span {"cipher init"};
+        GpgME::initializeLibrary();
+        auto err = GpgME::checkEngine(GpgME::Protocol::OpenPGP);
+        if (err.code() != GPG_ERR_NO_ERROR)
+            throw GpgME::Exception(err, "Failed to initialize OpenPGP engine");
+    });
 }
 
 std::vector<uint8_t> GPG::processPlainText(std::vector<uint8_t> plain_text, std::shared_ptr<Parameters>&& params)
 {
-    if (not params)
+    DPASTE_PROBE2(cipher_encrypt_entry, static_cast<int>(GPGParameters::scheme), plain_text.size());
+    if (not params) {
+        DPASTE_PROBE2(cipher_encrypt_return, 0, -1);
         return {};
+    }
 
     auto gparams = std::get<GPGParameters>(*params);
     /* we include self as recipient if there's at least one other recipient */
@@ -76,11 +97,16 @@ std::vector<uint8_t> GPG::processPlainText(std::vector<uint8_t> plain_text, std:
 
     auto to_sign = gparams.sign and not signerKey_.empty();
     if (not gparams.recipients.empty()) {
-        DPASTE_MSG("Encrypting (gpg)%s...", to_sign ? " and signing " : "");
+        DPASTE_TRACE_SCOPE("gpg encrypt", "crypto", plain_text.size());
+        static const auto& seconds = crypto_seconds("encrypt");
+        Metrics::Histogram::Timer timer {seconds};
+        DPASTE_LOG_INFO("Encrypting (gpg)%s...", to_sign ? " and signing " : "");
         auto res = encrypt(gparams.recipients, plain_text, to_sign);
+        DPASTE_PROBE2(cipher_encrypt_return, std::get<0>(res).size(), 0);
         return std::get<0>(res);
     }
 
+    DPASTE_PROBE2(cipher_encrypt_return, 0, -1);
     return {};
 }
 
@@ -89,14 +115,19 @@ GPG::processCipherText(std::vector<uint8_t> cipher_text, std::shared_ptr<Paramet
 {
     auto gparams = params ? std::get<GPGParameters>(*params) : GPGParameters {};
 
-    DPASTE_MSG("Decrypting (gpg)...");
+    DPASTE_LOG_INFO("Decrypting (gpg)...");
+    DPASTE_TRACE_SCOPE("gpg decrypt", "crypto", cipher_text.size());
+    static const auto& seconds = crypto_seconds("decrypt");
+    Metrics::Histogram::Timer timer {seconds};
+    DPASTE_PROBE2(cipher_decrypt_entry, static_cast<int>(GPGParameters::scheme), cipher_text.size());
     auto res = decryptAndVerify(cipher_text);
-    DPASTE_MSG("Success!");
+    DPASTE_LOG_INFO("Success!");
 
     auto data = std::move(std::get<0>(res));
     auto& verif_res = std::get<2>(res);
     if (verif_res.numSignatures() > 0)
         comment_on_signature(verif_res.signature(0));
+    DPASTE_PROBE2(cipher_decrypt_return, data.size(), 0);
     return data;
 }
 
@@ -162,13 +193,14 @@ GPG::decryptAndVerify(const std::vector<uint8_t>& cipher_text) const {
 
 std::pair<std::vector<uint8_t>,
     GpgME::SigningResult>
-GPG::sign(const std::vector<uint8_t>& plain_text) const {
+GPG::sign(const std::vector<uint8_t>& plain_text, bool detached) const {
     if (not ctx or ctx->signingKeys().empty())
         return {};
 
     GpgME::Data pt {reinterpret_cast<const char*>(plain_text.data()), plain_text.size()};
     GpgME::Data signature;
-    auto res = ctx->sign(pt, signature, GpgME::SignatureMode::NormalSignatureMode);
+    auto res = ctx->sign(pt, signature, detached ? GpgME::SignatureMode::Detached
+                                                 : GpgME::SignatureMode::NormalSignatureMode);
 
     if (res.error())
         throw GpgME::Exception(
@@ -179,13 +211,13 @@ GPG::sign(const std::vector<uint8_t>& plain_text) const {
 }
 
 GpgME::VerificationResult
-GPG::verify(const std::vector<uint8_t>& signature, const std::vector<uint8_t>& plain_text) const {
+GPG::verify(const std::vector<uint8_t>& signature, const std::vector<uint8_t>& plain_text, bool detached) const {
     if (not ctx)
         return {};
 
     GpgME::Data pt {reinterpret_cast<const char*>(plain_text.data()), plain_text.size()};
     GpgME::Data sig {reinterpret_cast<const char*>(signature.data()), signature.size()};
-    auto res = ctx->verifyOpaqueSignature(sig, pt);
+    auto res = detached ? ctx->verifyDetachedSignature(sig, pt) : ctx->verifyOpaqueSignature(sig, pt);
 
     if (res.error())
         throw GpgME::Exception(res.error());
@@ -196,7 +228,16 @@ GPG::verify(const std::vector<uint8_t>& signature, const std::vector<uint8_t>& p
 void GPG::comment_on_signature(const GpgME::Signature& sig) {
     const auto& s = sig.summary();
     if (s & GpgME::Signature::Valid)
-        DPASTE_MSG("Valid signature from key with ID %s", sig.fingerprint());
+        DPASTE_LOG_INFO("Valid signature from key with ID %s", sig.fingerprint());
+    else if (not (s & GpgME::Signature::Red))
+        DPASTE_LOG_WARN("Good signature from key with ID %s, which is not certified.", sig.fingerprint());
+}
+
+bool GPG::acceptable(const GpgME::VerificationResult& res) {
+    if (res.numSignatures() == 0)
+        return false;
+    const auto sig = res.signature(0);
+    return not (sig.summary() & GpgME::Signature::Red) and sig.status().code() == 0;
 }
 
 GpgME::Key GPG::getKey(const std::string& key_id) const {
@@ -212,8 +253,10 @@ GpgME::Key GPG::getKey(const std::string& key_id) const {
 }
 
 bool GPG::isGPGencrypted(const std::vector<uint8_t>& data) {
-    GpgME::Data d {reinterpret_cast<const char*>(data.data()), data.size()};
-    return d.type() == GpgME::Data::Type::PGPEncrypted;
+    /* dpaste always produces armored output (see ctx->setArmor(1)). Checking
+     * the armor header spares us from initializing gpgme on non-GPG pastes. */
+    const auto hlen = std::strlen(PGP_ARMOR_HEADER);
+    return data.size() >= hlen and std::equal(data.begin(), data.begin()+hlen, PGP_ARMOR_HEADER);
 }
 
 } /* crypto */
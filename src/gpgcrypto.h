@@ -42,6 +42,11 @@ public:
     GPG(std::string signer="");
     virtual ~GPG () {}
 
+    /**
+     * Initialize gpgme and check the OpenPGP engine. This is thread-safe and
+     * only done once. It is called by the constructor, so the engine is only
+     * started when GPG is actually used.
+     */
     static void init();
 
     std::vector<uint8_t>
@@ -60,14 +65,35 @@ public:
         GpgME::VerificationResult>
             decryptAndVerify(const std::vector<uint8_t>& cipher) const;
 
+    /**
+     * Sign data with the signer key.
+     *
+     * @param plain_text  The data to sign.
+     * @param detached    Whether the signature should be detached from the
+     *                    data instead of embedding it.
+     */
     std::pair<std::vector<uint8_t>,
         GpgME::SigningResult>
-            sign(const std::vector<uint8_t>& plain_text) const;
+            sign(const std::vector<uint8_t>& plain_text, bool detached=false) const;
 
-    GpgME::VerificationResult verify(const std::vector<uint8_t>& signature, const std::vector<uint8_t>& plain_text) const;
+    GpgME::VerificationResult verify(const std::vector<uint8_t>& signature,
+                                     const std::vector<uint8_t>& plain_text,
+                                     bool detached=false) const;
 
     void comment_on_signature(const GpgME::Signature& sig);
 
+    /**
+     * Whether the data verified may be written out. A bad signature, or one
+     * which can't be checked (e.g. for lack of the key), is refused. A good
+     * signature is accepted whatever the validity of its key, as gpg does: it
+     * is only told by comment_on_signature().
+     *
+     * @param res  The result of verify().
+     *
+     * @return true if the first signature is good, else false.
+     */
+    static bool acceptable(const GpgME::VerificationResult& res);
+
     static bool isGPGencrypted(const std::vector<uint8_t>& d);
 
 private:
@@ -0,0 +1,63 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hash.h"
+
+namespace dpaste {
+namespace crypto {
+
+const constexpr size_t Sha256::DIGEST_SIZE;
+
+Sha256::Digest Sha256::digest() {
+    Digest d;
+    sha256_digest(&ctx_, d.size(), d.data());
+    return d;
+}
+
+Sha256::Digest Sha256::hash(const std::vector<uint8_t>& data) {
+    Sha256 h;
+    h.update(data);
+    return h.digest();
+}
+
+Sha256::Digest Sha256::hmac(const std::vector<uint8_t>& key, const uint8_t* data, size_t size) {
+    hmac_sha256_ctx ctx;
+    hmac_sha256_set_key(&ctx, key.size(), key.data());
+    hmac_sha256_update(&ctx, size, data);
+    Digest d;
+    hmac_sha256_digest(&ctx, d.size(), d.data());
+    return d;
+}
+
+std::string Sha256::toHex(const Digest& digest) {
+    static const constexpr char* HEX = "0123456789abcdef";
+    std::string s;
+    s.reserve(digest.size()*2);
+    for (auto b : digest) {
+        s.push_back(HEX[b >> 4]);
+        s.push_back(HEX[b & 0xf]);
+    }
+    return s;
+}
+
+} /* crypto */
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
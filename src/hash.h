@@ -0,0 +1,77 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <nettle/sha2.h>
+#include <nettle/hmac.h>
+
+namespace dpaste {
+namespace crypto {
+
+/**
+ * Incremental SHA-256. Data can be fed in as many pieces as needed, e.g.
+ * while reading a stream or as DHT values come in.
+ */
+class Sha256 {
+public:
+    static const constexpr size_t DIGEST_SIZE {SHA256_DIGEST_SIZE};
+    using Digest = std::array<uint8_t, DIGEST_SIZE>;
+
+    Sha256() { sha256_init(&ctx_); }
+    virtual ~Sha256 () {}
+
+    void update(const uint8_t* data, size_t length) { sha256_update(&ctx_, length, data); }
+    void update(const std::vector<uint8_t>& data) { update(data.data(), data.size()); }
+
+    /**
+     * Get the digest of the data fed so far. The object is reset afterwards.
+     */
+    Digest digest();
+
+    static Digest hash(const std::vector<uint8_t>& data);
+
+    /**
+     * HMAC-SHA256 of some data.
+     *
+     * @param key   The key.
+     * @param data  The data.
+     * @param size  The size of the data.
+     */
+    static Digest hmac(const std::vector<uint8_t>& key, const uint8_t* data, size_t size);
+
+    /**
+     * Lower case hexadecimal representation of a digest.
+     */
+    static std::string toHex(const Digest& digest);
+
+private:
+    sha256_ctx ctx_;
+};
+
+} /* crypto */
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
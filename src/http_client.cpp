@@ -19,6 +19,7 @@
  */
 
 #include <fstream>
+#include <mutex>
 
 #include <curlpp/cURLpp.hpp>
 #include <curlpp/Easy.hpp>
@@ -31,6 +32,9 @@
 
 #include "http_client.h"
 #include "node.h"
+#include "trace.h"
+#include "metrics.h"
+#include "probes.h"
 
 namespace dpaste {
 
@@ -38,38 +42,91 @@ using json = nlohmann::json;
 
 static std::ofstream null("/dev/null");
 
+void HttpClient::init() {
+    /*
+     * curl global init and cleanup are not thread-safe: they are done once for
+     * the process, and never undone, rather than by each client while others
+     * may run.
+     */
+    static std::once_flag initialized;
+    std::call_once(initialized, []() { new curlpp::Cleanup; });
+}
+
+namespace {
+
+struct HttpMetrics {
+    const Metrics::Counter& gets {Metrics::counter("dpaste_gets_total", "Gets, by transport.", "transport=\"http\"")};
+    const Metrics::Counter& puts {Metrics::counter("dpaste_puts_total", "Puts, by transport.", "transport=\"http\"")};
+    const Metrics::Histogram& get_seconds {
+        Metrics::histogram("dpaste_get_seconds", "Time taken by gets, by transport.", "transport=\"http\"")};
+    const Metrics::Histogram& put_seconds {
+        Metrics::histogram("dpaste_put_seconds", "Time taken by puts, by transport.", "transport=\"http\"")};
+    const Metrics::Counter& get_bytes {
+        Metrics::counter("dpaste_get_bytes_total", "Bytes received by gets, by transport.", "transport=\"http\"")};
+    const Metrics::Counter& put_bytes {
+        Metrics::counter("dpaste_put_bytes_total", "Bytes sent by puts, by transport.", "transport=\"http\"")};
+};
+
+const HttpMetrics& metrics() {
+    static const HttpMetrics m;
+    return m;
+}
+
+} /* anonymous namespace */
+
 std::string HttpClient::get(const std::string& code) const {
+    DPASTE_TRACE_SCOPE("http get", "http");
+    metrics().gets.add();
+    Metrics::Histogram::Timer timer {metrics().get_seconds};
+    DPASTE_PROBE(http_get_entry);
+    long status {-1};
     try {
-        curlpp::Cleanup mycleanup;
         curlpp::Easy req;
         req.setOpt<curlpp::options::Port>(port);
-        std::stringstream response, oss;
+        std::stringstream response;
         req.setOpt<curlpp::options::Url>(HTTP_PROTO+
                 host+"/"+dht::InfoHash::get(code).toString()
                 +"?user_type="+dpaste::Node::DPASTE_USER_TYPE
         );
         req.setOpt(curlpp::Options::WriteStream(&response));
 
+        std::string data;
         try {
             req.perform();
+            status = curlpp::Infos::ResponseCode::get(req);
             /* server gives code 200 when everything is fine. */
-            if (curlpp::Infos::ResponseCode::get(req) == 200) {
-                auto pr = json::parse(response.str());
-                if (not pr.empty()) {
-                    std::istringstream iss((*pr.begin())["base64"].dump());
-                    base64::decoder d;
-                    d.decode(iss, oss);
-                }
-            }
+            if (status == 200)
+                data = decode(response.str());
         } catch (curlpp::RuntimeError & e) { }
 
-        return oss.str();
-    } catch (curlpp::LogicError & e) { return {}; }
+        metrics().get_bytes.add(data.size());
+        DPASTE_PROBE2(http_get_return, data.size(), status);
+        return data;
+    } catch (curlpp::LogicError & e) {
+        DPASTE_PROBE2(http_get_return, 0, status);
+        return {};
+    }
+}
+
+std::string HttpClient::decode(const std::string& response) {
+    auto pr = json::parse(response);
+    if (pr.empty())
+        return {};
+    std::istringstream iss((*pr.begin())["base64"].dump());
+    std::ostringstream oss;
+    base64::decoder d;
+    d.decode(iss, oss);
+    return oss.str();
 }
 
 bool HttpClient::put(const std::string& code, const std::string& data) const {
+    DPASTE_TRACE_SCOPE("http put", "http", data.size());
+    metrics().puts.add();
+    metrics().put_bytes.add(data.size());
+    Metrics::Histogram::Timer timer {metrics().put_seconds};
+    DPASTE_PROBE1(http_put_entry, data.size());
+    long status {-1};
     try {
-        curlpp::Cleanup mycleanup;
         curlpp::Easy req;
         req.setOpt<curlpp::options::Port>(port);
         req.setOpt<curlpp::options::Url>(HTTP_PROTO+host+"/"+dht::InfoHash::get(code).toString());
@@ -83,11 +140,11 @@ bool HttpClient::put(const std::string& code, const std::string& data) const {
 
         try {
             req.perform();
-            return curlpp::Infos::ResponseCode::get(req) == 200;
-        } catch (curlpp::RuntimeError & e) {
-            return false;
-        }
-    } catch (curlpp::LogicError & e) { return false; }
+            status = curlpp::Infos::ResponseCode::get(req);
+        } catch (curlpp::RuntimeError & e) { }
+    } catch (curlpp::LogicError & e) { }
+    DPASTE_PROBE2(http_put_return, data.size(), status);
+    return status == 200;
 }
 
 } /* dpaste */
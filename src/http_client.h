@@ -24,17 +24,34 @@
 
 namespace dpaste {
 
+/**
+ * Client for OpenDHT's HTTP proxy. Requests may be issued concurrently from
+ * several threads.
+ */
 class HttpClient {
 public:
-    HttpClient (std::string host, long port) : host(host), port(port) {}
+    HttpClient (std::string host, long port) : host(host), port(port) { init(); }
     virtual ~HttpClient () {}
 
     std::string get(const std::string& code) const;
     bool put(const std::string& code, const std::string& data) const;
 
+    /**
+     * Decode the body of a successful get response: the base64 data of the
+     * first value found by the proxy.
+     *
+     * @param response  The JSON body of the response.
+     *
+     * @return the data, or an empty string if no value was found.
+     */
+    static std::string decode(const std::string& response);
+
 private:
     static const constexpr char* HTTP_PROTO = "http://";
 
+    /* curl global init, once for the process */
+    static void init();
+
     std::string host; /* host for the http dht service */
     long port;        /* port for the http dht service */
 };
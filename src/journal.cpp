@@ -0,0 +1,157 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <sstream>
+#include <iterator>
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+}
+
+#include <glibmm.h>
+
+#include "journal.h"
+
+namespace dpaste {
+
+static const constexpr char* TAG_SET = "set";
+static const constexpr char* TAG_DONE = "done";
+
+static std::string journal_dir() {
+    const auto dir = Glib::get_user_cache_dir() + "/dpaste";
+    g_mkdir_with_parents(dir.c_str(), 0700);
+    return dir;
+}
+
+std::string Journal::path(const std::string& name) {
+    return journal_dir() + '/' + name;
+}
+
+void Journal::prune(std::chrono::seconds max_age) {
+    const auto dir = journal_dir();
+    const auto oldest = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()-max_age);
+    Glib::Dir d {dir};
+    for (auto name = d.read_name(); not name.empty(); name = d.read_name()) {
+        /* journals of Bin::paste and Bin::get only */
+        if (name.compare(0, 4, "get-") != 0 and name.compare(0, 6, "paste-") != 0)
+            continue;
+        const auto file = dir + '/' + name;
+        struct stat st;
+        if (stat(file.c_str(), &st) == 0 and st.st_mtime < oldest)
+            std::remove(file.c_str());
+    }
+}
+
+bool Journal::load() {
+    std::lock_guard<std::mutex> lck(mtx_);
+    std::ifstream in(path_, std::ios::in | std::ios::binary);
+    if (not in.is_open())
+        return false;
+
+    bool found {false};
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        std::string tag, name;
+        size_t size;
+        if (not (ss >> tag >> name >> size))
+            break;
+        std::vector<uint8_t> payload(size);
+        if (not in.read(reinterpret_cast<char*>(payload.data()), size))
+            break;
+        if (tag == TAG_SET)
+            values_[name] = std::move(payload);
+        else if (tag == TAG_DONE)
+            parts_[name] = std::move(payload);
+        found = true;
+    }
+    in.close();
+    open(std::ios::app);
+    return found;
+}
+
+void Journal::reset() {
+    std::lock_guard<std::mutex> lck(mtx_);
+    values_.clear();
+    parts_.clear();
+    file_.close();
+    open(std::ios::trunc);
+}
+
+void Journal::remove() {
+    std::lock_guard<std::mutex> lck(mtx_);
+    file_.close();
+    std::remove(path_.c_str());
+}
+
+void Journal::open(std::ios::openmode mode) {
+    /* the directory may predate its mode 0700, and the journal be left from an older version */
+    const int fd = ::open(path_.c_str(), O_WRONLY | O_CREAT, 0600);
+    if (fd >= 0) {
+        fchmod(fd, 0600);
+        close(fd);
+    }
+    file_.open(path_, std::ios::out | std::ios::binary | mode);
+}
+
+void Journal::append(const std::string& tag, const std::string& name, const std::vector<uint8_t>& payload) {
+    if (not file_.is_open())
+        open(std::ios::app);
+    file_ << tag << ' ' << name << ' ' << payload.size() << '\n';
+    file_.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+    file_.flush();
+}
+
+void Journal::set(const std::string& key, const std::vector<uint8_t>& value) {
+    std::lock_guard<std::mutex> lck(mtx_);
+    append(TAG_SET, key, value);
+    values_[key] = value;
+}
+
+std::vector<uint8_t> Journal::get(const std::string& key) const {
+    std::lock_guard<std::mutex> lck(mtx_);
+    auto v = values_.find(key);
+    return v != values_.end() ? v->second : std::vector<uint8_t> {};
+}
+
+void Journal::done(const crypto::Sha256::Digest& leaf, const std::vector<uint8_t>& part) {
+    std::lock_guard<std::mutex> lck(mtx_);
+    const auto name = crypto::Sha256::toHex(leaf);
+    append(TAG_DONE, name, part);
+    parts_[name] = part;
+}
+
+bool Journal::has(const crypto::Sha256::Digest& leaf) const {
+    std::lock_guard<std::mutex> lck(mtx_);
+    return parts_.count(crypto::Sha256::toHex(leaf));
+}
+
+std::vector<uint8_t> Journal::part(const crypto::Sha256::Digest& leaf) const {
+    std::lock_guard<std::mutex> lck(mtx_);
+    auto p = parts_.find(crypto::Sha256::toHex(leaf));
+    return p != parts_.end() ? p->second : std::vector<uint8_t> {};
+}
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
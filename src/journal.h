@@ -0,0 +1,124 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#include "hash.h"
+
+namespace dpaste {
+
+/**
+ * Checkpoint journal of a paste or get spanning several values. Every record
+ * is appended and flushed as soon as the work it describes is done, so that an
+ * interrupted run can be resumed from where it stopped.
+ *
+ * A record is a line "<tag> <name> <size>" followed by <size> bytes of
+ * payload. A record cut short by a crash is ignored on load.
+ */
+class Journal {
+public:
+    /**
+     * @param path  The path of the journal file (see Journal::path).
+     */
+    Journal(std::string path) : path_(std::move(path)) {}
+    virtual ~Journal () {}
+
+    /**
+     * Path of a journal in the user's cache directory
+     * ($XDG_CACHE_HOME/dpaste). The directory is created if needed.
+     *
+     * @param name  The name of the journal.
+     */
+    static std::string path(const std::string& name);
+
+    /**
+     * Delete the journals of the cache directory last written more than
+     * max_age ago. Those of pastes and gets abandoned or failed otherwise stay
+     * there forever, along with the parts and passwords they hold.
+     *
+     * @param max_age  The age past which a journal is of no use, e.g. the
+     *                 expiration of the values it describes.
+     */
+    static void prune(std::chrono::seconds max_age);
+
+    /**
+     * Load the records written by a previous run.
+     *
+     * @return true if any record was found, else false.
+     */
+    bool load();
+
+    /**
+     * Drop every record and start a new journal.
+     */
+    void reset();
+
+    /**
+     * Delete the journal file, once the work is complete.
+     */
+    void remove();
+
+    /**
+     * Record a named value.
+     */
+    void set(const std::string& key, const std::vector<uint8_t>& value);
+    std::vector<uint8_t> get(const std::string& key) const;
+
+    /**
+     * Record that a part is done (stored or received).
+     *
+     * @param leaf  The leaf hash of the part.
+     * @param part  The content of the part, if it should be kept.
+     */
+    void done(const crypto::Sha256::Digest& leaf, const std::vector<uint8_t>& part = {});
+
+    /**
+     * @return whether a part was recorded as done.
+     */
+    bool has(const crypto::Sha256::Digest& leaf) const;
+
+    /**
+     * @return the content kept for a part. Empty if none.
+     */
+    std::vector<uint8_t> part(const crypto::Sha256::Digest& leaf) const;
+
+private:
+    /* open file_, creating the file readable by the user only: it may hold a password */
+    void open(std::ios::openmode mode);
+    void append(const std::string& tag, const std::string& name, const std::vector<uint8_t>& payload);
+
+    std::string path_;
+    std::ofstream file_ {};
+    mutable std::mutex mtx_ {};
+    std::map<std::string, std::vector<uint8_t>> values_ {};
+    std::map<std::string, std::vector<uint8_t>> parts_ {};
+};
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
@@ -0,0 +1,233 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cerrno>
+#include <stdexcept>
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+}
+
+#include <glibmm.h>
+
+#include "keeper.h"
+
+namespace dpaste {
+
+static const constexpr char* TAG_KEEP = "keep";
+
+/* a record of the file, its line and payload */
+static std::string record(const std::string& code, const std::vector<uint8_t>& value) {
+    std::ostringstream r;
+    r << TAG_KEEP << ' ' << code << ' ' << value.size() << '\n';
+    r.write(reinterpret_cast<const char*>(value.data()), value.size());
+    return r.str();
+}
+
+static bool write_all(int fd, const std::string& buffer) {
+    for (size_t written = 0; written < buffer.size();) {
+        const auto n = write(fd, buffer.data()+written, buffer.size()-written);
+        if (n < 0 and errno == EINTR)
+            continue;
+        if (n < 0)
+            return false;
+        written += n;
+    }
+    return true;
+}
+
+std::string Keeper::path() {
+    const auto dir = Glib::get_user_data_dir() + "/dpaste";
+    g_mkdir_with_parents(dir.c_str(), 0700);
+    return dir + "/kept";
+}
+
+std::string Keeper::spool_dir() {
+    const auto dir = Glib::get_user_data_dir() + "/dpaste/spool";
+    g_mkdir_with_parents(dir.c_str(), 0700);
+    return dir;
+}
+
+std::ifstream Keeper::load() {
+    for (;;) {
+        struct stat before, after;
+        if (stat(path_.c_str(), &before) != 0)
+            return {};
+        std::ifstream in(path_, std::ios::in | std::ios::binary);
+        /* the file was replaced while opening it */
+        if (stat(path_.c_str(), &after) != 0 or after.st_ino != before.st_ino)
+            continue;
+        if (not in.is_open())
+            return in;
+        if (static_cast<uint64_t>(before.st_ino) != inode_) {
+            records_.clear();
+            loaded_ = 0;
+            inode_ = before.st_ino;
+        }
+        in.seekg(0, std::ios::end);
+        const uint64_t end = in.tellg();
+        in.seekg(loaded_);
+
+        std::string line;
+        while (std::getline(in, line) and not in.eof()) {
+            std::istringstream ss(line);
+            std::string tag, code;
+            uint64_t size;
+            if (not (ss >> tag >> code >> size))
+                break;
+            const uint64_t offset = in.tellg();
+            /* a record cut short is read again once complete */
+            if (offset+size > end)
+                break;
+            if (tag == TAG_KEEP)
+                records_[code] = {offset, size};
+            loaded_ = offset+size;
+            in.seekg(loaded_);
+        }
+        in.clear();
+        return in;
+    }
+}
+
+std::vector<uint8_t> Keeper::read(std::ifstream& in, const Record& r) const {
+    std::vector<uint8_t> value(r.size);
+    in.seekg(r.offset);
+    if (not in.read(reinterpret_cast<char*>(value.data()), value.size()))
+        return {};
+    return value;
+}
+
+void Keeper::keep(const std::string& code, const std::vector<uint8_t>& value) {
+    std::lock_guard<std::mutex> lck(mtx_);
+    /* Keeper::forget holds a lock on the file it replaces: wait for it, then
+     * append to the new one */
+    int fd;
+    for (;;) {
+        fd = open(path_.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0600);
+        if (fd < 0)
+            return;
+        flock(fd, LOCK_EX);
+        struct stat opened, current;
+        if (fstat(fd, &opened) == 0 and stat(path_.c_str(), &current) == 0 and opened.st_ino == current.st_ino)
+            break;
+        close(fd);
+    }
+
+    auto in = load();
+    const auto r = records_.find(code);
+    if (r == records_.end() or r->second.size != value.size() or read(in, r->second) != value)
+        write_all(fd, record(code, value));
+    close(fd);
+}
+
+size_t Keeper::forget(const std::set<std::string>& codes) {
+    std::lock_guard<std::mutex> lck(mtx_);
+    const int fd = open(path_.c_str(), O_RDONLY);
+    if (fd < 0)
+        return 0;
+    flock(fd, LOCK_EX);
+
+    auto in = load();
+    size_t forgotten {0};
+    const auto tmp = path_+".tmp";
+    /* as private as the file it replaces, even if left over by a failed call */
+    const int out = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    bool written = out >= 0 and fchmod(out, 0600) == 0;
+    for (auto r = records_.begin(); written and r != records_.end(); ++r) {
+        if (codes.count(r->first)) {
+            ++forgotten;
+            continue;
+        }
+        const auto value = read(in, r->second);
+        written = value.size() == r->second.size and write_all(out, record(r->first, value));
+    }
+    if (out >= 0)
+        written = close(out) == 0 and written;
+    if (not written or std::rename(tmp.c_str(), path_.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        close(fd);
+        throw std::runtime_error("Failed to rewrite " + path_);
+    }
+    close(fd);
+    return forgotten;
+}
+
+size_t Keeper::size() {
+    std::lock_guard<std::mutex> lck(mtx_);
+    load();
+    return records_.size();
+}
+
+std::vector<std::string> Keeper::codes() {
+    std::lock_guard<std::mutex> lck(mtx_);
+    load();
+    std::vector<std::string> codes;
+    codes.reserve(records_.size());
+    for (const auto& r : records_)
+        codes.emplace_back(r.first);
+    return codes;
+}
+
+std::vector<uint8_t> Keeper::get(const std::string& code) {
+    std::lock_guard<std::mutex> lck(mtx_);
+    auto in = load();
+    const auto r = records_.find(code);
+    return r != records_.end() and in.is_open() ? read(in, r->second) : std::vector<uint8_t> {};
+}
+
+std::vector<std::pair<std::string, std::vector<uint8_t>>> Keeper::next(size_t count) {
+    std::lock_guard<std::mutex> lck(mtx_);
+    auto in = load();
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> values;
+    if (not in.is_open())
+        return values;
+    auto r = records_.upper_bound(last_);
+    for (size_t i = 0; i < std::min(count, records_.size()); ++i, ++r) {
+        if (r == records_.end())
+            r = records_.begin();
+        auto value = read(in, r->second);
+        if (value.size() != r->second.size)
+            break;
+        values.emplace_back(r->first, std::move(value));
+        last_ = r->first;
+    }
+    return values;
+}
+
+std::chrono::milliseconds Keeper::batch_delay(size_t values, size_t batch, std::chrono::milliseconds period,
+                                              double max_rate)
+{
+    if (not values)
+        return period;
+    const auto even = period.count()*static_cast<double>(std::min(batch, values))/values;
+    const auto fastest = 1000.*std::min(batch, values)/max_rate;
+    return std::chrono::milliseconds {static_cast<int64_t>(std::ceil(std::max(even, fastest)))};
+}
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
@@ -0,0 +1,149 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+
+namespace dpaste {
+
+/**
+ * Store of the values to keep alive on the DHT (see Bin::refresh). Values are
+ * kept in a file of records, in the format of the Journal: a line
+ * "keep <code> <size>" followed by <size> bytes of payload. Only the position
+ * of each value is held in memory, so that thousands of pastes can be kept.
+ * Values kept by other processes are found as soon as the file grows.
+ * Keeper::forget rewrites the file without the values no longer kept.
+ *
+ * The values of a queued paste are also kept this way, in a file of the spool
+ * directory, until Bin::flush publishes them.
+ */
+class Keeper {
+public:
+    /**
+     * @param path  The path of the file (see Keeper::path).
+     */
+    Keeper(std::string path) : path_(std::move(path)) {}
+    virtual ~Keeper () {}
+
+    /**
+     * Path of the store in the user's data directory
+     * ($XDG_DATA_HOME/dpaste). The directory is created if needed.
+     */
+    static std::string path();
+
+    /**
+     * The spool directory of queued pastes ($XDG_DATA_HOME/dpaste/spool). It
+     * is created if needed.
+     */
+    static std::string spool_dir();
+
+    /**
+     * Keep a value. A value kept again under the same code replaces the
+     * previous one, unless it is the same: nothing is written then.
+     *
+     * @param code   The code the value is stored under.
+     * @param value  The value.
+     */
+    void keep(const std::string& code, const std::vector<uint8_t>& value);
+
+    /**
+     * Stop keeping values. The file is rewritten with the other values only,
+     * dropping the ones replaced since as well.
+     *
+     * @param codes  The codes of the values.
+     *
+     * @return the number of values which were kept under those codes.
+     */
+    size_t forget(const std::set<std::string>& codes);
+
+    /**
+     * @return the number of values kept.
+     */
+    size_t size();
+
+    /**
+     * @return the codes of the values kept.
+     */
+    std::vector<std::string> codes();
+
+    /**
+     * @param code  The code.
+     *
+     * @return the value kept under code. Empty if there is none.
+     */
+    std::vector<uint8_t> get(const std::string& code);
+
+    /**
+     * The next values to republish. Values are handed out in turn, so that
+     * each one is republished once per round.
+     *
+     * @param count  The number of values.
+     *
+     * @return up to count pairs of code and value.
+     */
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> next(size_t count);
+
+    /**
+     * Delay between batches for every value to be republished once per
+     * period, spreading the puts evenly over it.
+     *
+     * @param values    The number of values kept.
+     * @param batch     The number of values per batch.
+     * @param period    The time between two republications of a value.
+     * @param max_rate  The maximum number of values republished per second.
+     *                  The period is stretched if it would be exceeded.
+     */
+    static std::chrono::milliseconds batch_delay(size_t values, size_t batch, std::chrono::milliseconds period,
+                                                 double max_rate);
+
+private:
+    /* position and size of the payload of a record in the file */
+    struct Record {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    /* read the records appended since the last call, or all of them if the
+     * file was rewritten by Keeper::forget meanwhile. The file is left open to
+     * read the values of those records. */
+    std::ifstream load();
+    std::vector<uint8_t> read(std::ifstream& in, const Record& r) const;
+
+    std::string path_;
+    std::mutex mtx_ {};
+    /* inode of the file loaded */
+    uint64_t inode_ {0};
+    uint64_t loaded_ {0};
+    std::map<std::string, Record> records_ {};
+    /* code of the last value handed out by next() */
+    std::string last_ {};
+};
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
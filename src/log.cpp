@@ -19,40 +19,250 @@
  */
 
 #include <array>
+#include <mutex>
+#include <thread>
+#include <memory>
 #include <iostream>
-#include <stdio.h>
-#include <stdarg.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 #include "log.h"
 
+namespace dpaste {
+
+namespace {
+
 static constexpr const char* DPASTE_MSG_PREFIX = "DPASTE: ";
+/* how long the logger's thread sleeps at most when there is nothing to write */
+static constexpr std::chrono::milliseconds IDLE_DELAY {10};
+
+/*
+ * Bounded multi-producer queue after Dmitry Vyukov's: a slot may be claimed
+ * at `pos` when its sequence is `pos`, and read once it is `pos+1`.
+ */
+struct Ring {
+    static const constexpr size_t SIZE {256};
+
+    struct Slot {
+        std::atomic<size_t> seq;
+        Log::Record record;
+    };
+
+    std::unique_ptr<Slot[]> slots {new Slot[SIZE]};
+    std::atomic<size_t> head {0};
+    /* only touched by the logger's thread */
+    size_t tail {0};
+    std::atomic<uint64_t> dropped {0};
+    std::atomic_bool idle {false};
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::condition_variable written_cv;
+    size_t written {0};
 
-void print_log(char const *m, va_list args) {
-    std::array<char, 8192> buffer;
-    int ret = vsnprintf(buffer.data(), buffer.size(), m, args);
-    if (ret < 0)
+    Ring() {
+        for (size_t i = 0; i < SIZE; ++i)
+            slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    Slot& slot(size_t pos) { return slots[pos & (SIZE-1)]; }
+};
+
+/* never destroyed: any thread may log until the process exits */
+std::atomic<Ring*> ring_ {nullptr};
+
+const char* level_prefix(Log::Level level) {
+    switch (level) {
+    case Log::Level::ERROR: return "error: ";
+    case Log::Level::WARN:  return "warning: ";
+    case Log::Level::DEBUG: return "debug: ";
+    case Log::Level::TRACE: return "trace: ";
+    default:                return "";
+    }
+}
+
+void consume(Ring& r) {
+    for (;;) {
+        size_t n {0};
+        for (;; ++n) {
+            auto& slot = r.slot(r.tail);
+            if (slot.seq.load(std::memory_order_acquire) != r.tail+1)
+                break;
+            const auto line = Log::format(slot.record);
+            std::cerr << DPASTE_MSG_PREFIX << level_prefix(slot.record.level) << line << '\n';
+            slot.seq.store(r.tail+Ring::SIZE, std::memory_order_release);
+            ++r.tail;
+        }
+        if (auto dropped = r.dropped.exchange(0)) {
+            std::cerr << DPASTE_MSG_PREFIX << "[[" << dropped << " MESSAGES DROPPED]]" << '\n';
+            ++n;
+        }
+        if (n)
+            std::cerr.flush();
+
+        std::unique_lock<std::mutex> lk(r.mtx);
+        r.written = r.tail;
+        r.written_cv.notify_all();
+        r.idle = true;
+        r.cv.wait_for(lk, IDLE_DELAY, [&]() {
+            return r.slot(r.tail).seq.load(std::memory_order_acquire) == r.tail+1;
+        });
+        r.idle = false;
+    }
+}
+
+Ring& ring() {
+    static Ring* r = []() {
+        auto r = new Ring;
+        std::thread(consume, std::ref(*r)).detach();
+        ring_ = r;
+        std::atexit(Log::flush);
+        return r;
+    }();
+    return *r;
+}
+
+} /* anonymous namespace */
+
+void Log::Record::add_string(Arg& a, const char* s, size_t len) {
+    a.type = Arg::Type::STRING;
+    if (text_len == TEXT_SIZE) {
+        /* no room left: the terminator of the last string */
+        a.str = TEXT_SIZE-1;
         return;
+    }
+    a.str = text_len;
+    len = std::min(len, TEXT_SIZE-text_len-1);
+    std::copy(s, s+len, text+text_len);
+    text_len += len;
+    text[text_len++] = '\0';
+}
 
-    std::cerr << DPASTE_MSG_PREFIX;
+bool Log::parse_level(const std::string& name, Level& level) {
+    static const std::pair<const char*, Level> levels[] = {
+        {"off", Level::OFF}, {"error", Level::ERROR}, {"warn", Level::WARN}, {"info", Level::INFO},
+        {"debug", Level::DEBUG}, {"trace", Level::TRACE}
+    };
+    for (const auto& l : levels)
+        if (name == l.first) {
+            level = l.second;
+            return true;
+        }
+    return false;
+}
 
-    // write log
-    std::cerr.write(buffer.data(), std::min((size_t) ret, buffer.size()));
-    if ((size_t) ret >= buffer.size())
-        std::cerr << "[[TRUNCATED]]";
-    std::cerr << std::endl;
+Log::Record* Log::claim() {
+    auto& r = ring();
+    auto pos = r.head.load(std::memory_order_relaxed);
+    for (;;) {
+        auto& slot = r.slot(pos);
+        const auto seq = slot.seq.load(std::memory_order_acquire);
+        const auto diff = static_cast<intptr_t>(seq)-static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (r.head.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+                slot.record.pos = pos;
+                return &slot.record;
+            }
+        } else if (diff < 0) {
+            r.dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else
+            pos = r.head.load(std::memory_order_relaxed);
+    }
 }
 
-void DPASTE_MSG(char const* format, ...) {
-#ifndef DPASTE_TEST
-    va_list args;
-    va_start(args, format);
-    print_log(format, args);
-    va_end(args);
-#endif
+void Log::commit(Record* record) {
+    auto& r = *ring_.load(std::memory_order_relaxed);
+    r.slot(record->pos).seq.store(record->pos+1, std::memory_order_release);
+    /* a missed wake up only delays the message by IDLE_DELAY */
+    if (r.idle.load(std::memory_order_relaxed))
+        r.cv.notify_one();
 }
 
-/* vim:set et sw=4 ts=4 tw=120: */
+void Log::flush() {
+    auto r = ring_.load();
+    if (not r)
+        return;
+    const auto head = r->head.load();
+    r->cv.notify_one();
+    std::unique_lock<std::mutex> lk(r->mtx);
+    r->written_cv.wait(lk, [&]() { return r->written >= head; });
+}
 
+std::string Log::format(const Record& r) {
+    std::string out;
+    std::array<char, 512> buffer;
+    size_t arg {0};
+    for (const char* f = r.format; *f; ++f) {
+        if (*f != '%') {
+            out += *f;
+            continue;
+        }
+        if (f[1] == '%') {
+            out += '%';
+            ++f;
+            continue;
+        }
+        /* flags, width and precision are kept, length modifiers are ours */
+        std::string spec {"%"};
+        const char* c = f+1;
+        while (*c and std::strchr("-+ #0123456789.", *c))
+            spec += *c++;
+        while (*c and std::strchr("hljztL", *c))
+            ++c;
+        if (not *c)
+            break;
+        f = c;
+        if (arg == r.nargs) {
+            out += "(missing)";
+            continue;
+        }
+        const auto& a = r.args[arg++];
+        const long long i = a.type == Arg::Type::UINT ? static_cast<long long>(a.u)
+                          : a.type == Arg::Type::DOUBLE ? static_cast<long long>(a.d)
+                          : a.type == Arg::Type::INT ? a.i : 0;
+        int n {0};
+        switch (*c) {
+        case 'd': case 'i':
+            n = std::snprintf(buffer.data(), buffer.size(), (spec+"ll"+*c).c_str(), i);
+            break;
+        case 'o': case 'u': case 'x': case 'X':
+            n = std::snprintf(buffer.data(), buffer.size(), (spec+"ll"+*c).c_str(),
+                              a.type == Arg::Type::UINT ? a.u : static_cast<unsigned long long>(i));
+            break;
+        case 'c':
+            n = std::snprintf(buffer.data(), buffer.size(), (spec+*c).c_str(), static_cast<int>(i));
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            n = std::snprintf(buffer.data(), buffer.size(), (spec+*c).c_str(),
+                              a.type == Arg::Type::DOUBLE ? a.d
+                              : a.type == Arg::Type::UINT ? static_cast<double>(a.u) : static_cast<double>(i));
+            break;
+        case 's':
+            n = std::snprintf(buffer.data(), buffer.size(), (spec+*c).c_str(),
+                              a.type == Arg::Type::STRING ? r.text+a.str : "(?)");
+            break;
+        case 'p':
+            n = std::snprintf(buffer.data(), buffer.size(), (spec+*c).c_str(),
+                              a.type == Arg::Type::POINTER ? a.p : nullptr);
+            break;
+        default:
+            out += '%';
+            out += *c;
+            continue;
+        }
+        if (n > 0)
+            out.append(buffer.data(), std::min(static_cast<size_t>(n), buffer.size()-1));
+    }
+    return out;
+}
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
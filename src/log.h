@@ -18,7 +18,172 @@
  * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-void DPASTE_MSG(char const* format, ...);
+#pragma once
 
-/* vim:set et sw=4 ts=4 tw=120: */
+#include <string>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+namespace dpaste {
+
+/**
+ * Leveled logger writing to the standard error from a thread of its own.
+ *
+ * Logging copies the format, which must be a string literal, and the
+ * arguments in a slot of a lock-free ring buffer: formatting and I/O happen
+ * on the logger's thread. Logging is thus cheap and safe from any thread,
+ * including the DHT callbacks. When the ring is full, messages are dropped
+ * and their number is reported.
+ *
+ * The DPASTE_LOG_* macros compile out messages above DPASTE_LOG_MAX_LEVEL,
+ * arguments included. Those above the level set at run time only cost a
+ * comparison.
+ */
+class Log {
+public:
+    enum class Level : int { OFF = -1, ERROR, WARN, INFO, DEBUG, TRACE };
+
+    static const constexpr size_t MAX_ARGS {8};
+    /* room for the string arguments of a message, which are truncated past it */
+    static const constexpr size_t TEXT_SIZE {256};
+
+    struct Arg {
+        enum class Type : uint8_t { INT, UINT, DOUBLE, STRING, POINTER };
+        Type type;
+        union {
+            long long i;
+            unsigned long long u;
+            double d;
+            const void* p;
+            /* offset in Record::text */
+            size_t str;
+        };
+    };
+
+    struct Record {
+        Level level;
+        const char* format;
+        size_t nargs;
+        Arg args[MAX_ARGS];
+        size_t text_len;
+        char text[TEXT_SIZE];
+        /* position in the ring */
+        size_t pos;
+
+        template <typename T>
+        void add(const T& v) {
+            if (nargs == MAX_ARGS)
+                return;
+            auto& a = args[nargs++];
+            if constexpr (std::is_same_v<T, std::string>) {
+                add_string(a, v.data(), v.size());
+            } else if constexpr (std::is_convertible_v<const T&, const char*>) {
+                const char* s = v;
+                add_string(a, s ? s : "(null)", s ? std::strlen(s) : 6);
+            } else if constexpr (std::is_floating_point_v<T>) {
+                a.type = Arg::Type::DOUBLE;
+                a.d = v;
+            } else if constexpr (std::is_enum_v<T>) {
+                a.type = Arg::Type::INT;
+                a.i = static_cast<long long>(v);
+            } else if constexpr (std::is_integral_v<T> and std::is_signed_v<T>) {
+                a.type = Arg::Type::INT;
+                a.i = v;
+            } else if constexpr (std::is_integral_v<T>) {
+                a.type = Arg::Type::UINT;
+                a.u = v;
+            } else {
+                static_assert(std::is_pointer_v<T>, "unsupported log argument");
+                a.type = Arg::Type::POINTER;
+                a.p = v;
+            }
+        }
+
+        void add_string(Arg& a, const char* s, size_t len);
+    };
 
+    /**
+     * Set the level of the messages written at run time. Messages above it
+     * are discarded. It is INFO by default, OFF in unit tests.
+     */
+    static void set_level(Level level) { level_.store(static_cast<int>(level), std::memory_order_relaxed); }
+    static Level level() { return static_cast<Level>(level_.load(std::memory_order_relaxed)); }
+    static bool enabled(Level level) {
+        return static_cast<int>(level) <= level_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @param name   One of "off", "error", "warn", "info", "debug" and "trace".
+     * @param level  The level named.
+     *
+     * @return true if the name is one of a level, else false.
+     */
+    static bool parse_level(const std::string& name, Level& level);
+
+    /**
+     * Log a message formatted as by printf. Use the DPASTE_LOG_* macros
+     * instead, which skip it entirely when its level is off.
+     */
+    template <typename... Args>
+    static void write(Level level, const char* format, const Args&... args) {
+        auto r = claim();
+        if (not r)
+            return;
+        r->level = level;
+        r->format = format;
+        r->nargs = 0;
+        r->text_len = 0;
+        (r->add(args), ...);
+        commit(r);
+    }
+
+    /**
+     * Block until every message logged so far is written. This is done at
+     * exit.
+     */
+    static void flush();
+
+    /**
+     * Format a record as printf would. Integers are widened as needed, hence
+     * length modifiers may be omitted.
+     */
+    static std::string format(const Record& r);
+
+private:
+#ifdef DPASTE_TEST
+    static inline std::atomic_int level_ {static_cast<int>(Level::OFF)};
+#else
+    static inline std::atomic_int level_ {static_cast<int>(Level::INFO)};
+#endif
+
+    /* a free slot of the ring, or nullptr if it is full */
+    static Record* claim();
+    /* hand a claimed slot to the logger's thread */
+    static void commit(Record* r);
+};
+
+} /* dpaste */
+
+#ifndef DPASTE_LOG_MAX_LEVEL
+#define DPASTE_LOG_MAX_LEVEL 3 /* debug */
+#endif
+
+#define DPASTE_LOG(level, ...) do { \
+    if constexpr (static_cast<int>(level) <= DPASTE_LOG_MAX_LEVEL) \
+        if (::dpaste::Log::enabled(level)) \
+            ::dpaste::Log::write(level, __VA_ARGS__); \
+} while (0)
+
+#define DPASTE_LOG_ERROR(...) DPASTE_LOG(::dpaste::Log::Level::ERROR, __VA_ARGS__)
+#define DPASTE_LOG_WARN(...)  DPASTE_LOG(::dpaste::Log::Level::WARN, __VA_ARGS__)
+#define DPASTE_LOG_INFO(...)  DPASTE_LOG(::dpaste::Log::Level::INFO, __VA_ARGS__)
+#define DPASTE_LOG_DEBUG(...) DPASTE_LOG(::dpaste::Log::Level::DEBUG, __VA_ARGS__)
+#define DPASTE_LOG_TRACE(...) DPASTE_LOG(::dpaste::Log::Level::TRACE, __VA_ARGS__)
+
+/* vim:set et sw=4 ts=4 tw=120: */
@@ -20,6 +20,12 @@
 
 #include <memory>
 #include <string>
+#include <fstream>
+#include <limits>
+#include <atomic>
+#include <csignal>
+#include <chrono>
+#include <future>
 
 #include <vector>
 
@@ -33,6 +39,10 @@ extern "C" {
 
 #include "bin.h"
 #include "cipher.h"
+#include "stats.h"
+#include "trace.h"
+#include "metrics.h"
+#include "log.h"
 
 /* Command line parsing */
 struct ParsedArgs {
@@ -44,8 +54,29 @@ struct ParsedArgs {
     bool gpg_encrypt {false};
     bool no_decrypt {false};
     bool self_recipient {false};
+    bool resume {false};
+    bool stream {false};
+    bool follow {false};
+    bool keep {false};
+    bool refresh {false};
+    bool queue {false};
+    bool flush {false};
+    bool stats {false};
+    bool stats_json {false};
+    bool stats_prometheus {false};
+    long parity {-1};
+    long replicas {-1};
     std::string code;
+    std::string update_code;
+    std::string watch_code;
+    std::string unkeep_code;
+    std::string trace_file;
     std::vector<std::string> recipients;
+    std::vector<std::string> files;
+    std::string extract;
+    bool range {false};
+    uint64_t range_offset {0};
+    uint64_t range_length {std::numeric_limits<uint64_t>::max()};
 };
 
 static const constexpr struct option long_options[] = {
@@ -58,13 +89,31 @@ static const constexpr struct option long_options[] = {
    {"sign",           no_argument,       nullptr, 's'},
    {"no-decrypt",     no_argument,       nullptr, '1'},
    {"self-recipient", no_argument,       nullptr, '2'},
+   {"parity",         required_argument, nullptr, '5'},
+   {"update",         required_argument, nullptr, '6'},
+   {"resume",         no_argument,       nullptr, '7'},
+   {"file",           required_argument, nullptr, 'f'},
+   {"extract",        required_argument, nullptr, '8'},
+   {"range",          required_argument, nullptr, '9'},
+   {"watch",          required_argument, nullptr, '0'},
+   {"stream",         no_argument,       nullptr, 'A'},
+   {"follow",         no_argument,       nullptr, 'B'},
+   {"replicas",       required_argument, nullptr, 'C'},
+   {"keep",           no_argument,       nullptr, 'D'},
+   {"refresh",        no_argument,       nullptr, 'E'},
+   {"queue",          no_argument,       nullptr, 'F'},
+   {"flush",          no_argument,       nullptr, 'G'},
+   {"stats",          optional_argument, nullptr, 'H'},
+   {"trace",          required_argument, nullptr, 'I'},
+   {"log-level",      required_argument, nullptr, 'J'},
+   {"unkeep",         required_argument, nullptr, 'K'},
    {nullptr,          0,                 nullptr,  0 }
 };
 
 ParsedArgs parseArgs(int argc, char *argv[]) {
     ParsedArgs pa;
     int opt;
-    while ((opt = getopt_long(argc, argv, "hvg:r:s", long_options, nullptr)) != -1) {
+    while ((opt = getopt_long(argc, argv, "hvg:r:sf:", long_options, nullptr)) != -1) {
         switch (opt) {
         case 'h':
             pa.help = true;
@@ -93,6 +142,92 @@ ParsedArgs parseArgs(int argc, char *argv[]) {
         case '2':
             pa.self_recipient = true;
             break;
+        case '5':
+            pa.parity = std::strtol(optarg, nullptr, 10);
+            break;
+        case 'D':
+            pa.keep = true;
+            break;
+        case 'E':
+            pa.refresh = true;
+            break;
+        case 'K':
+            pa.unkeep_code = std::string(optarg);
+            break;
+        case 'F':
+            pa.queue = true;
+            break;
+        case 'G':
+            pa.flush = true;
+            break;
+        case 'H':
+            pa.stats = true;
+            if (optarg and std::string(optarg) == "json")
+                pa.stats_json = true;
+            else if (optarg and std::string(optarg) == "prometheus")
+                pa.stats_prometheus = true;
+            else if (optarg) {
+                std::cerr << "Unknown stats format: " << optarg << " (expecting json or prometheus)" << std::endl;
+                pa.fail = true;
+                return pa;
+            }
+            break;
+        case 'J': {
+            dpaste::Log::Level level;
+            if (not dpaste::Log::parse_level(optarg, level)) {
+                std::cerr << "Unknown log level: " << optarg << " (expecting off, error, warn, info, debug or trace)"
+                          << std::endl;
+                pa.fail = true;
+                return pa;
+            }
+            dpaste::Log::set_level(level);
+            break;
+        }
+        case 'I':
+            if (not dpaste::Trace::available()) {
+                std::cerr << "dpaste was built without tracing (see --enable-trace)." << std::endl;
+                pa.fail = true;
+                return pa;
+            }
+            pa.trace_file = std::string(optarg);
+            break;
+        case 'C':
+            pa.replicas = std::strtol(optarg, nullptr, 10);
+            break;
+        case '6':
+            pa.update_code = std::string(optarg);
+            break;
+        case '7':
+            pa.resume = true;
+            break;
+        case '0':
+            pa.watch_code = std::string(optarg);
+            break;
+        case 'A':
+            pa.stream = true;
+            break;
+        case 'B':
+            pa.follow = true;
+            break;
+        case 'f':
+            pa.files.emplace_back(std::string(optarg));
+            break;
+        case '8':
+            pa.extract = std::string(optarg);
+            break;
+        case '9': {
+            char* end;
+            pa.range = true;
+            pa.range_offset = std::strtoull(optarg, &end, 10);
+            if (*end != ':') {
+                std::cerr << "Malformed range: " << optarg << " (expecting OFFSET:LENGTH)" << std::endl;
+                pa.fail = true;
+                return pa;
+            }
+            if (*(end+1))
+                pa.range_length = std::strtoull(end+1, nullptr, 10);
+            break;
+        }
         default:
             pa.fail = true;
             return pa;
@@ -102,13 +237,14 @@ ParsedArgs parseArgs(int argc, char *argv[]) {
 }
 
 void print_help() {
-    std::cout << PACKAGE_NAME << " -- A simple pastebin for light values (max 64KB)"
-                              << " using OpenDHT distributed hash table." << std::endl << std::endl;
+    std::cout << PACKAGE_NAME << " -- A simple pastebin using OpenDHT distributed hash table." << std::endl
+              << "Data larger than a DHT value (64KB) is split across several values." << std::endl << std::endl;
 
     std::cout << "SYNOPSIS" << std::endl
               << "    " << PACKAGE_NAME << " [-h]" << std::endl
               << "    " << PACKAGE_NAME << " [-v]" << std::endl
-              << "    " << PACKAGE_NAME << " [-g code]" << std::endl;
+              << "    " << PACKAGE_NAME << " [-g code]" << std::endl
+              << "    " << PACKAGE_NAME << " [-f file...]" << std::endl;
 
     std::cout << "OPTIONS"
               << std::endl;
@@ -125,6 +261,30 @@ void print_help() {
               << "        Get the pasted file under the code {code}."
               << std::endl;
 
+    std::cout << "    --watch {code}" << std::endl
+              << "        Print every value pasted under the code {code} as soon as it is announced on the DHT," << std::endl
+              << "        until interrupted." << std::endl;
+
+    std::cout << "    --stream" << std::endl
+              << "        Print a code right away, then paste the standard input as it is written, in batches of" << std::endl
+              << "        lines, until end of file." << std::endl;
+
+    std::cout << "    --follow" << std::endl
+              << "        With -g, print the stream pasted under the code {code} (see --stream) as it is written," << std::endl
+              << "        until it ends or is interrupted." << std::endl;
+
+    std::cout << "    --extract {name}" << std::endl
+              << "        With -g, get only the file {name} of an archive paste. Getting an archive paste without" << std::endl
+              << "        this option lists its files." << std::endl;
+
+    std::cout << "    --range {offset}:{length}" << std::endl
+              << "        With -g, get only {length} bytes from {offset} (of the file given by --extract, if any)." << std::endl
+              << "        If {length} is omitted, get everything from {offset}." << std::endl;
+
+    std::cout << "    -f|--file {file}" << std::endl
+              << "        Paste the file {file} instead of the standard input. Use '-f' multiple times to paste an" << std::endl
+              << "        archive of several files." << std::endl;
+
     std::cout << "    --aes-encrypt" << std::endl
               << "        Use AES scheme for encryption. Password is automatically saved in " << std::endl;
     std::cout << "        the returned code (\"dpaste:XXXXXX\")." << std::endl;
@@ -148,8 +308,58 @@ void print_help() {
               << "        Include self as recipient. Self refers to the key id configured for signing" << std::endl;
     std::cout << "        (see --sign description). This only takes effect if option \"-e\" is also used." << std::endl;
 
+    std::cout << "    --parity {n}" << std::endl
+              << "        Number of parity values computed for every 16 values of data when pasting data larger" << std::endl
+              << "        than one value. Overrides the \"parity\" option of the configuration file." << std::endl;
+
+    std::cout << "    --replicas {n}" << std::endl
+              << "        Number of codes a paste is stored under, for its retrieval to be spread over the DHT." << std::endl
+              << "        When getting, number of such codes to look the paste up in. Overrides the \"replicas\"" << std::endl
+              << "        option of the configuration file." << std::endl;
+
+    std::cout << "    --keep" << std::endl
+              << "        Keep the paste alive: its values are saved locally for --refresh to republish them." << std::endl;
+
+    std::cout << "    --refresh" << std::endl
+              << "        Republish the values of the pastes kept with --keep before they expire, until" << std::endl
+              << "        interrupted." << std::endl;
+
+    std::cout << "    --unkeep {code}" << std::endl
+              << "        Stop keeping alive the paste under the code {code}: its values are removed from those" << std::endl
+              << "        saved by --keep." << std::endl;
+
+    std::cout << "    --queue" << std::endl
+              << "        Print the code right away and save the paste locally instead of publishing it. It is" << std::endl
+              << "        published by --flush, or after the next paste or get reaching the network." << std::endl;
+
+    std::cout << "    --flush" << std::endl
+              << "        Publish the pastes saved by --queue." << std::endl;
+
+    std::cout << "    --stats[=json|prometheus]" << std::endl
+              << "        Report the wall and CPU time spent in each stage, along with the bytes it handled and its" << std::endl
+              << "        heap allocations, on the standard error. Use '--stats=json' for a JSON report." << std::endl
+              << "        '--stats=prometheus' reports the counts, latencies and failures of gets and puts per" << std::endl
+              << "        transport and the crypto time instead, in the Prometheus text format." << std::endl;
+
+    std::cout << "    --log-level {level}" << std::endl
+              << "        Only print the messages of the given level or more severe: off, error, warn, info (the" << std::endl
+              << "        default), debug or trace." << std::endl;
+
+    std::cout << "    --trace {file}" << std::endl
+              << "        Write Chrome trace events of the run to {file}, to be loaded in chrome://tracing or" << std::endl
+              << "        Perfetto. Only available if dpaste was built with tracing." << std::endl;
+
+    std::cout << "    --update {code}" << std::endl
+              << "        Paste standard input as a new version of the paste under the code {code}. Parts left" << std::endl
+              << "        unchanged are not uploaded again. Use the same encryption options as for {code}." << std::endl;
+
+    std::cout << "    --resume" << std::endl
+              << "        Resume an interrupted paste (of the same data) or get (of the same code) spanning several" << std::endl
+              << "        values. Values already transferred are skipped." << std::endl;
+
     std::cout << std::endl;
-    std::cout << "When -g option is ommited, " << PACKAGE_NAME << " will read its standard input for a file to paste."
+    std::cout << "When -g option is ommited, " << PACKAGE_NAME << " will read its standard input (or the files given by -f)"
+              << std::endl << "for a file to paste."
               << std::endl;
 }
 
@@ -168,6 +378,92 @@ std::unique_ptr<dpaste::crypto::Parameters> params_from_args(const ParsedArgs& p
     return params;
 }
 
+static std::atomic_bool interrupted {false};
+/* time given to publish queued pastes after another command */
+static const constexpr std::chrono::seconds AUTO_FLUSH_TIMEOUT {5};
+
+int run(ParsedArgs& parsed_args) {
+    dpaste::Bin dpastebin {};
+    if (parsed_args.parity >= 0)
+        dpastebin.set_parity(parsed_args.parity);
+    if (parsed_args.replicas > 0)
+        dpastebin.set_replicas(parsed_args.replicas);
+    dpastebin.set_resume(parsed_args.resume);
+    dpastebin.set_keep(parsed_args.keep);
+    dpastebin.set_queue(parsed_args.queue);
+    int rc;
+    if (not parsed_args.watch_code.empty() or parsed_args.follow or parsed_args.refresh) {
+        std::signal(SIGINT, [](int) { interrupted = true; });
+        std::signal(SIGTERM, [](int) { interrupted = true; });
+    }
+    if (parsed_args.flush) {
+        return dpastebin.flush() ? 0 : 1;
+    } else if (not parsed_args.unkeep_code.empty()) {
+        return dpastebin.unkeep(std::move(parsed_args.unkeep_code)) ? 0 : 1;
+    } else if (parsed_args.refresh) {
+        rc = dpastebin.refresh(&interrupted) ? 0 : 1;
+    } else if (not parsed_args.watch_code.empty()) {
+        rc = dpastebin.watch(std::move(parsed_args.watch_code), std::cout, parsed_args.no_decrypt, &interrupted) ? 0 : 1;
+    } else if (not parsed_args.code.empty() and parsed_args.follow) {
+        rc = dpastebin.follow(std::move(parsed_args.code), std::cout, &interrupted) ? 0 : 1;
+    } else if (parsed_args.stream) {
+        rc = dpastebin.stream(std::cin, params_from_args(parsed_args), [](const std::string& uri) {
+            std::cout << uri << std::endl;
+        }) ? 0 : 1;
+    } else if (not parsed_args.code.empty() and (parsed_args.range or not parsed_args.extract.empty())) {
+        rc = dpastebin.extract(std::move(parsed_args.code), std::cout, parsed_args.extract,
+                               parsed_args.range_offset, parsed_args.range_length) ? 0 : 1;
+    } else if (not parsed_args.code.empty()) {
+        rc = dpastebin.get(std::move(parsed_args.code), std::cout, parsed_args.no_decrypt) ? 0 : 1;
+    } else if (parsed_args.files.size() > 1) {
+        std::vector<std::pair<std::string, std::vector<uint8_t>>> files;
+        for (const auto& name : parsed_args.files) {
+            std::ifstream f(name, std::ios::in | std::ios::binary);
+            if (not f.is_open()) {
+                std::cerr << "Can't open " << name << std::endl;
+                return 1;
+            }
+            files.emplace_back(name, std::vector<uint8_t> {std::istreambuf_iterator<char>(f), {}});
+        }
+        auto uri = dpastebin.paste(std::move(files), params_from_args(parsed_args));
+        std::cout << uri << std::endl;
+        rc = uri.empty() ? 1 : 0;
+    } else {
+        std::stringstream ss;
+        {
+            dpaste::Stats::Span span {"read"};
+            if (parsed_args.files.empty())
+                ss << std::cin.rdbuf();
+            else {
+                std::ifstream f(parsed_args.files.front(), std::ios::in | std::ios::binary);
+                if (not f.is_open()) {
+                    std::cerr << "Can't open " << parsed_args.files.front() << std::endl;
+                    return 1;
+                }
+                ss << f.rdbuf();
+            }
+            span.bytes_out(ss.tellp());
+        }
+        auto uri = parsed_args.update_code.empty()
+            ? dpastebin.paste(std::move(ss), params_from_args(parsed_args))
+            : dpastebin.update(std::move(parsed_args.update_code), std::move(ss), params_from_args(parsed_args));
+        std::cout << uri << std::endl;
+        rc = uri.empty() ? 1 : 0;
+    }
+
+    /* the network was reached: publish what was queued meanwhile, without holding the exit back for long */
+    if (rc == 0 and not parsed_args.queue and dpastebin.reached_network() and dpaste::Bin::queued()) {
+        std::atomic_bool late {false};
+        auto flush = std::async(std::launch::async, [&]() { return dpastebin.flush(&late); });
+        if (flush.wait_for(AUTO_FLUSH_TIMEOUT) == std::future_status::timeout) {
+            late = true;
+            DPASTE_LOG_INFO("Queued pastes not published yet are left for --flush.");
+        }
+        flush.get();
+    }
+    return rc;
+}
+
 int main(int argc, char *argv[]) {
     auto parsed_args = parseArgs(argc, argv);
     if (parsed_args.fail) {
@@ -180,24 +476,18 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
-    dpaste::Bin dpastebin {};
-    dpaste::crypto::Cipher::init();
-    int rc;
-    if (not parsed_args.code.empty()) {
-        auto r = dpastebin.get(std::move(parsed_args.code), parsed_args.no_decrypt);
-        if (r.first) {
-            rc = 0;
-            std::cout << r.second;
-        } else
-            rc = 1;
-    } else {
-        std::stringstream ss;
-        ss << std::cin.rdbuf();
-        auto uri = dpastebin.paste(std::move(ss), params_from_args(parsed_args));
-        std::cout << uri << std::endl;
-        rc = uri.empty() ? 1 : 0;
-    }
-
+    if (parsed_args.stats)
+        dpaste::Stats::enable();
+    if (not parsed_args.trace_file.empty())
+        dpaste::Trace::start(parsed_args.trace_file);
+    int rc = run(parsed_args);
+    dpaste::Log::flush();
+    if (not parsed_args.trace_file.empty() and not dpaste::Trace::stop())
+        std::cerr << "Failed to write the trace to " << parsed_args.trace_file << std::endl;
+    if (parsed_args.stats_prometheus)
+        dpaste::Metrics::snapshot(std::cerr);
+    else if (parsed_args.stats)
+        dpaste::Stats::report(std::cerr, parsed_args.stats_json);
     return rc;
 }
 
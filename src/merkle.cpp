@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "merkle.h"
+
+namespace dpaste {
+namespace crypto {
+
+static const constexpr uint8_t LEAF_PREFIX {0x00};
+static const constexpr uint8_t NODE_PREFIX {0x01};
+
+Merkle::Digest Merkle::leaf(const std::vector<uint8_t>& data) {
+    Sha256 h;
+    h.update(&LEAF_PREFIX, 1);
+    h.update(data);
+    return h.digest();
+}
+
+Merkle::Digest Merkle::root(std::vector<Digest> leaves) {
+    if (leaves.empty())
+        return Sha256::hash({});
+
+    Sha256 h;
+    while (leaves.size() > 1) {
+        size_t n = 0;
+        for (size_t i = 0; i+1 < leaves.size(); i += 2) {
+            h.update(&NODE_PREFIX, 1);
+            h.update(leaves[i].data(), leaves[i].size());
+            h.update(leaves[i+1].data(), leaves[i+1].size());
+            leaves[n++] = h.digest();
+        }
+        if (leaves.size() % 2)
+            leaves[n++] = leaves.back();
+        leaves.resize(n);
+    }
+    return leaves.front();
+}
+
+} /* crypto */
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
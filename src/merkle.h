@@ -0,0 +1,58 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "hash.h"
+
+namespace dpaste {
+namespace crypto {
+
+/**
+ * Binary Merkle tree over SHA-256. As in RFC 6962, leaves and interior nodes
+ * are hashed with distinct prefixes (0x00 and 0x01) so that one can't be
+ * passed for the other. A node without sibling is promoted as is.
+ */
+class Merkle {
+public:
+    using Digest = Sha256::Digest;
+
+    /**
+     * Hash of a leaf of the tree.
+     *
+     * @param data  The data covered by the leaf.
+     */
+    static Digest leaf(const std::vector<uint8_t>& data);
+
+    /**
+     * Compute the root of the tree over given leaves.
+     *
+     * @param leaves  The leaf hashes, in order.
+     */
+    static Digest root(std::vector<Digest> leaves);
+};
+
+} /* crypto */
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
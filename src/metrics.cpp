@@ -0,0 +1,189 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <mutex>
+#include <memory>
+#include <array>
+#include <deque>
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+#include "metrics.h"
+
+namespace dpaste {
+
+const constexpr size_t Metrics::MAX_SLOTS;
+const constexpr size_t Metrics::BUCKETS;
+const constexpr size_t Metrics::HISTOGRAM_SLOTS;
+
+namespace {
+
+using Slots = std::array<std::atomic<uint64_t>, Metrics::MAX_SLOTS>;
+
+struct Metric {
+    bool histogram;
+    std::string name;
+    std::string help;
+    std::string labels;
+    size_t slot;
+    /* what counter() and histogram() hand out */
+    std::unique_ptr<Metrics::Counter> counter;
+    std::unique_ptr<Metrics::Histogram> hist;
+};
+
+struct Registry {
+    std::mutex mtx;
+    std::deque<Metric> metrics;
+    size_t slots {0};
+    std::vector<Slots*> shards;
+    /* what the threads which exited recorded */
+    std::array<uint64_t, Metrics::MAX_SLOTS> retired {};
+};
+
+/* never destroyed: threads may still record while the process exits */
+Registry& registry() {
+    static auto* r = new Registry;
+    return *r;
+}
+
+struct Shard {
+    Slots slots {};
+
+    Shard() {
+        auto& r = registry();
+        std::lock_guard<std::mutex> lk(r.mtx);
+        r.shards.push_back(&slots);
+    }
+    ~Shard() {
+        auto& r = registry();
+        std::lock_guard<std::mutex> lk(r.mtx);
+        for (size_t i = 0; i < r.slots; ++i)
+            r.retired[i] += slots[i].load(std::memory_order_relaxed);
+        r.shards.erase(std::find(r.shards.begin(), r.shards.end(), &slots));
+    }
+};
+
+/* with the registry locked */
+uint64_t sum(Registry& r, size_t slot) {
+    uint64_t n = r.retired[slot];
+    for (const auto* s : r.shards)
+        n += (*s)[slot].load(std::memory_order_relaxed);
+    return n;
+}
+
+Metric& find_or_add(bool histogram, const std::string& name, const std::string& help, const std::string& labels) {
+    auto& r = registry();
+    auto m = std::find_if(r.metrics.begin(), r.metrics.end(), [&](const Metric& m) {
+        return m.histogram == histogram and m.name == name and m.labels == labels;
+    });
+    if (m != r.metrics.end())
+        return *m;
+    const size_t slots = histogram ? Metrics::HISTOGRAM_SLOTS : 1;
+    if (r.slots+slots > Metrics::MAX_SLOTS)
+        throw std::length_error("too many metrics");
+    r.metrics.push_back({histogram, name, help, labels, r.slots, {}, {}});
+    r.slots += slots;
+    return r.metrics.back();
+}
+
+std::string with_le(const std::string& labels, const std::string& le) {
+    return "{"+labels+(labels.empty() ? "" : ",")+"le=\""+le+"\"}";
+}
+
+std::string braced(const std::string& labels) {
+    return labels.empty() ? "" : "{"+labels+"}";
+}
+
+} /* anonymous namespace */
+
+std::atomic<uint64_t>* Metrics::local() {
+    thread_local Shard shard;
+    return shard.slots.data();
+}
+
+const Metrics::Counter& Metrics::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    auto& r = registry();
+    std::lock_guard<std::mutex> lk(r.mtx);
+    auto& m = find_or_add(false, name, help, labels);
+    if (not m.counter)
+        m.counter.reset(new Counter(m.slot));
+    return *m.counter;
+}
+
+const Metrics::Histogram& Metrics::histogram(const std::string& name, const std::string& help,
+                                             const std::string& labels)
+{
+    auto& r = registry();
+    std::lock_guard<std::mutex> lk(r.mtx);
+    auto& m = find_or_add(true, name, help, labels);
+    if (not m.hist)
+        m.hist.reset(new Histogram(m.slot));
+    return *m.hist;
+}
+
+void Metrics::snapshot(std::ostream& out) {
+    auto& r = registry();
+    std::lock_guard<std::mutex> lk(r.mtx);
+    const auto flags = out.flags();
+    const auto precision = out.precision(9);
+
+    std::vector<std::string> names;
+    for (const auto& m : r.metrics)
+        if (std::find(names.begin(), names.end(), m.name) == names.end())
+            names.push_back(m.name);
+
+    for (const auto& name : names) {
+        bool header {false};
+        for (const auto& m : r.metrics) {
+            if (m.name != name)
+                continue;
+            if (not header) {
+                out << "# HELP " << m.name << ' ' << m.help << '\n'
+                    << "# TYPE " << m.name << (m.histogram ? " histogram" : " counter") << '\n';
+                header = true;
+            }
+            if (not m.histogram) {
+                out << m.name << braced(m.labels) << ' ' << sum(r, m.slot) << '\n';
+                continue;
+            }
+            uint64_t count {0};
+            for (size_t b = 0; b+1 < BUCKETS; ++b) {
+                count += sum(r, m.slot+b);
+                std::ostringstream le;
+                le.precision(9);
+                le << bucket_bound(b)/1e9;
+                out << m.name << "_bucket" << with_le(m.labels, le.str()) << ' ' << count << '\n';
+            }
+            count += sum(r, m.slot+BUCKETS-1);
+            out << m.name << "_bucket" << with_le(m.labels, "+Inf") << ' ' << count << '\n'
+                << m.name << "_sum" << braced(m.labels) << ' ' << sum(r, m.slot+BUCKETS)/1e9 << '\n'
+                << m.name << "_count" << braced(m.labels) << ' ' << count << '\n';
+        }
+    }
+    out.precision(precision);
+    out.flags(flags);
+    out.flush();
+}
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
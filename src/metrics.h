@@ -0,0 +1,165 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <ostream>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace dpaste {
+
+/**
+ * Process-wide counters and histograms, dumped by snapshot() in the
+ * Prometheus text format.
+ *
+ * Each thread records in a shard of its own, so recording takes no lock and
+ * no atomic read-modify-write: it is a couple of relaxed loads and stores.
+ * snapshot() adds up the shards, including those of threads which exited.
+ *
+ * Metrics are meant to be registered once, e.g. in a static local:
+ *
+ *     static const auto& gets = Metrics::counter("dpaste_gets_total", "Gets.", "transport=\"dht\"");
+ *     gets.add();
+ */
+class Metrics {
+public:
+    /* Total slots of a shard. A counter takes one, a histogram HISTOGRAM_SLOTS. */
+    static const constexpr size_t MAX_SLOTS {2048};
+
+    /*
+     * Histograms are log-linear over nanoseconds: values up to 2^MIN_SHIFT,
+     * then SUB_BUCKETS buckets per power of two over GROUPS powers of two,
+     * then everything above.
+     */
+    static const constexpr unsigned MIN_SHIFT {10};
+    static const constexpr unsigned SUB_BUCKETS {4};
+    static const constexpr unsigned GROUPS {30};
+    static const constexpr size_t BUCKETS {1+GROUPS*SUB_BUCKETS+1};
+    /* the buckets and the sum */
+    static const constexpr size_t HISTOGRAM_SLOTS {BUCKETS+1};
+
+    class Counter {
+    public:
+        void add(uint64_t n = 1) const { bump(slot_, n); }
+
+    private:
+        friend class Metrics;
+        explicit Counter(size_t slot) : slot_(slot) {}
+        size_t slot_;
+    };
+
+    class Histogram {
+    public:
+        /**
+         * Observes the time from its construction to its destruction.
+         */
+        class Timer {
+        public:
+            explicit Timer(const Histogram& h) : h_(h), start_(std::chrono::steady_clock::now()) {}
+            ~Timer() { h_.observe(std::chrono::steady_clock::now()-start_); }
+
+        private:
+            const Histogram& h_;
+            std::chrono::steady_clock::time_point start_;
+        };
+
+        void observe(std::chrono::nanoseconds d) const {
+            const uint64_t ns = d.count() > 0 ? d.count() : 0;
+            bump(slot_+bucket(ns), 1);
+            bump(slot_+BUCKETS, ns);
+        }
+
+    private:
+        friend class Metrics;
+        explicit Histogram(size_t slot) : slot_(slot) {}
+        size_t slot_;
+    };
+
+    /**
+     * Register a counter, or get the one registered with the same name and
+     * labels.
+     *
+     * @param name    The name of the metric, conventionally ending in _total.
+     * @param help    A description of the metric. Only the first one
+     *                registered under a name is kept.
+     * @param labels  The labels of the metric, e.g. transport="dht".
+     *
+     * @throw std::length_error if every slot is taken.
+     */
+    static const Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    /**
+     * Register a histogram of durations, or get the one registered with the
+     * same name and labels. It is exposed in seconds.
+     *
+     * @see counter()
+     */
+    static const Histogram& histogram(const std::string& name, const std::string& help,
+                                      const std::string& labels = "");
+
+    /**
+     * Write every metric in the Prometheus text format.
+     */
+    static void snapshot(std::ostream& out);
+
+    /**
+     * @param ns  A number of nanoseconds.
+     *
+     * @return the histogram bucket holding it.
+     */
+    static size_t bucket(uint64_t ns) {
+        if (ns <= 1u << MIN_SHIFT)
+            return 0;
+        const uint64_t v = ns-1;
+        const unsigned log = 63-__builtin_clzll(v);
+        const size_t g = log-MIN_SHIFT;
+        if (g >= GROUPS)
+            return BUCKETS-1;
+        return 1+g*SUB_BUCKETS+((v >> (log-2)) & (SUB_BUCKETS-1));
+    }
+
+    /**
+     * @return the inclusive upper bound of a bucket, in nanoseconds. The last
+     *         bucket has none.
+     */
+    static uint64_t bucket_bound(size_t bucket) {
+        if (bucket == 0)
+            return 1u << MIN_SHIFT;
+        const size_t g = (bucket-1)/SUB_BUCKETS, s = (bucket-1)%SUB_BUCKETS;
+        return uint64_t {SUB_BUCKETS+s+1} << (g+MIN_SHIFT-2);
+    }
+
+private:
+    /* the shard of the calling thread */
+    static std::atomic<uint64_t>* local();
+
+    static void bump(size_t slot, uint64_t n) {
+        /* only this thread writes its shard */
+        auto& s = local()[slot];
+        s.store(s.load(std::memory_order_relaxed)+n, std::memory_order_relaxed);
+    }
+};
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
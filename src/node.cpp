@@ -19,35 +19,94 @@
  */
 
 #include <algorithm>
+#include <cstring>
 #include <random>
 #include <future>
+#include <deque>
 
 #include <opendht.h>
 
 #include "node.h"
+#include "trace.h"
+#include "metrics.h"
+#include "probes.h"
+#include "log.h"
 
 namespace dpaste {
 
+namespace {
+
+struct DhtMetrics {
+    const Metrics::Counter& gets {Metrics::counter("dpaste_gets_total", "Gets, by transport.", "transport=\"dht\"")};
+    const Metrics::Counter& puts {Metrics::counter("dpaste_puts_total", "Puts, by transport.", "transport=\"dht\"")};
+    const Metrics::Histogram& get_seconds {
+        Metrics::histogram("dpaste_get_seconds", "Time taken by gets, by transport.", "transport=\"dht\"")};
+    const Metrics::Histogram& put_seconds {
+        Metrics::histogram("dpaste_put_seconds", "Time taken by puts, by transport.", "transport=\"dht\"")};
+    const Metrics::Counter& get_bytes {
+        Metrics::counter("dpaste_get_bytes_total", "Bytes received by gets, by transport.", "transport=\"dht\"")};
+    const Metrics::Counter& put_bytes {
+        Metrics::counter("dpaste_put_bytes_total", "Bytes sent by puts, by transport.", "transport=\"dht\"")};
+    const Metrics::Counter& get_failures {
+        Metrics::counter("dpaste_dht_failures_total", "DHT operations which failed.", "op=\"get\"")};
+    const Metrics::Counter& put_failures {
+        Metrics::counter("dpaste_dht_failures_total", "DHT operations which failed.", "op=\"put\"")};
+};
+
+const DhtMetrics& metrics() {
+    static const DhtMetrics m;
+    return m;
+}
+
+} /* anonymous namespace */
+
 const constexpr char* Node::DPASTE_USER_TYPE;
+const constexpr uint16_t Node::DPASTE_VALUE_TYPE;
+const constexpr std::chrono::minutes Node::VALUE_EXPIRATION;
+
+dht::Value::Id Node::value_id(const dht::Blob& blob) {
+    const auto h = dht::InfoHash::get(blob);
+    dht::Value::Id id;
+    std::memcpy(&id, h.data(), sizeof(id));
+    /* the DHT draws a random id for this one */
+    return id != dht::Value::INVALID_ID ? id : 1;
+}
 
 bool Node::paste(const std::string& code, dht::Blob&& blob, dht::DoneCallbackSimple&& cb) {
+    DPASTE_PROBE1(node_paste_entry, blob.size());
     auto v = std::make_shared<dht::Value>(std::forward<dht::Blob>(blob));
+    v->id = value_id(v->data);
     v->user_type = DPASTE_USER_TYPE;
+    v->type = DPASTE_VALUE_TYPE;
 
     auto hash = dht::InfoHash::get(code);
+    metrics().puts.add();
+    metrics().put_bytes.add(v->data.size());
+    const auto start = std::chrono::steady_clock::now();
 
     if (cb) {
-        node_.put(hash, v, cb);
+        node_.put(hash, v, [cb = std::move(cb), start](bool success) {
+            metrics().put_seconds.observe(std::chrono::steady_clock::now()-start);
+            if (not success)
+                metrics().put_failures.add();
+            cb(success);
+        });
+        DPASTE_PROBE2(node_paste_return, v->data.size(), 0);
         return true;
     } else {
         std::mutex mtx;
         std::condition_variable cv;
         std::unique_lock<std::mutex> lk(mtx);
         bool done, success_ {false};
+        DPASTE_TRACE_ASYNC_BEGIN("dht put", "dht", &mtx);
         node_.put(hash, v, [&](bool success) {
-            if (not success)
-                std::cerr << OPERATION_FAILURE_MSG << " (put)" << std::endl;
-            else
+            DPASTE_TRACE_THREAD("dht");
+            DPASTE_TRACE_ASYNC_END("dht put", "dht", &mtx);
+            metrics().put_seconds.observe(std::chrono::steady_clock::now()-start);
+            if (not success) {
+                metrics().put_failures.add();
+                DPASTE_LOG_ERROR("%s (put)", OPERATION_FAILURE_MSG);
+            } else
                 success_ = true;
             {
                 std::unique_lock<std::mutex> lk(mtx);
@@ -56,36 +115,160 @@ bool Node::paste(const std::string& code, dht::Blob&& blob, dht::DoneCallbackSim
             cv.notify_all();
         });
         cv.wait(lk, [&](){ return done; });
+        DPASTE_PROBE2(node_paste_return, v->data.size(), success_ ? 0 : -1);
         return success_;
     }
 }
 
 void Node::get(const std::string& code, PastedCallback&& pcb) {
     auto blobs = std::make_shared<std::vector<dht::Blob>>();
+    metrics().gets.add();
+    const auto start = std::chrono::steady_clock::now();
     node_.get(dht::InfoHash::get(code),
         [blobs](std::shared_ptr<dht::Value> value) {
+            DPASTE_TRACE_THREAD("dht");
+            DPASTE_TRACE_SCOPE("get values", "dht", value->data.size());
+            metrics().get_bytes.add(value->data.size());
             blobs->emplace_back(value->data);
             return true;
         },
-        [pcb,blobs](bool success) {
-            if (not success)
-                std::cerr << OPERATION_FAILURE_MSG << " (get)" << std::endl;
-            else if (pcb)
+        [pcb,blobs,start](bool success) {
+            metrics().get_seconds.observe(std::chrono::steady_clock::now()-start);
+            if (not success) {
+                metrics().get_failures.add();
+                DPASTE_LOG_ERROR("%s (get)", OPERATION_FAILURE_MSG);
+            } else if (pcb)
                 pcb(*blobs);
         }, dht::Value::AllFilter(), dht::Where{}.userType(std::string(DPASTE_USER_TYPE))
     );
 }
 
 std::vector<dht::Blob> Node::get(const std::string& code) {
+    metrics().gets.add();
+    Metrics::Histogram::Timer timer {metrics().get_seconds};
     auto values = node_.get(dht::InfoHash::get(code),
             dht::Value::AllFilter(),
             dht::Where{}.userType(DPASTE_USER_TYPE)).get();
     std::vector<dht::Blob> blobs (values.size());
     std::transform(values.begin(), values.end(), blobs.begin(), [] (const decltype(values)::value_type& value) {
+        metrics().get_bytes.add(value->data.size());
         return value->data;
     });
     return blobs;
 }
 
+bool Node::paste(const std::string& code, dht::Blob&& blob, unsigned replicas) {
+    std::vector<std::future<bool>> pending;
+    for (unsigned r = 1; r < replicas; ++r)
+        pending.emplace_back(std::async(std::launch::async, [this, code = replica_code(code, r), blob]() mutable {
+            return paste(code, std::move(blob));
+        }));
+    auto success = paste(code, std::forward<dht::Blob>(blob));
+    for (auto& f : pending)
+        success = f.get() and success;
+    return success;
+}
+
+dht::Blob Node::get(const std::string& code, const AcceptCallback& accept, size_t* examined,
+                    unsigned replicas, unsigned* replica)
+{
+    DPASTE_PROBE1(node_get_entry, replicas);
+    replicas = std::max(replicas, 1u);
+    unsigned first {0};
+    if (replicas > 1) {
+        std::lock_guard<std::mutex> lk(rand_mtx_);
+        first = codeDist_(rand_) % replicas;
+    }
+    size_t n {0};
+    dht::Blob blob;
+    /* the chosen replica, then every other one (the code itself first) */
+    for (unsigned i = 0; i <= replicas and blob.empty(); ++i) {
+        const auto r = i ? i-1 : first;
+        if (i and r == first)
+            continue;
+        blob = get_one(replica_code(code, r), accept, n);
+        if (not blob.empty() and replica)
+            *replica = r;
+    }
+    if (examined)
+        *examined = n;
+    DPASTE_PROBE3(node_get_return, blob.size(), blob.empty() ? -1 : 0, n);
+    return blob;
+}
+
+dht::Blob Node::get_one(const std::string& code, const AcceptCallback& accept, size_t& examined) {
+    /* shared with the DHT thread, which may call back after we returned */
+    struct Search {
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<dht::Blob> blobs;
+        bool done {false};
+        bool found {false};
+    };
+    auto search = std::make_shared<Search>();
+    metrics().gets.add();
+    Metrics::Histogram::Timer timer {metrics().get_seconds};
+    DPASTE_TRACE_ASYNC_BEGIN("dht get", "dht", search.get());
+    node_.get(dht::InfoHash::get(code),
+        dht::GetCallback {[search](const std::vector<std::shared_ptr<dht::Value>>& values) {
+            DPASTE_TRACE_THREAD("dht");
+            DPASTE_TRACE_SCOPE("get values", "dht");
+            std::lock_guard<std::mutex> lk(search->mtx);
+            if (search->found)
+                return false;
+            for (const auto& v : values)
+                search->blobs.emplace_back(v->data);
+            search->cv.notify_all();
+            return true;
+        }},
+        [search](bool success) {
+            DPASTE_TRACE_ASYNC_END("dht get", "dht", search.get());
+            std::lock_guard<std::mutex> lk(search->mtx);
+            if (not success) {
+                metrics().get_failures.add();
+                DPASTE_LOG_ERROR("%s (get)", OPERATION_FAILURE_MSG);
+            }
+            search->done = true;
+            search->cv.notify_all();
+        }, dht::Value::AllFilter(), dht::Where{}.userType(DPASTE_USER_TYPE)
+    );
+
+    std::unique_lock<std::mutex> lk(search->mtx);
+    for (;;) {
+        search->cv.wait(lk, [&]() { return search->done or not search->blobs.empty(); });
+        if (search->blobs.empty())
+            break;
+        auto blob = std::move(search->blobs.front());
+        search->blobs.pop_front();
+        lk.unlock();
+        ++examined;
+        const bool accepted = not accept or accept(blob);
+        lk.lock();
+        if (accepted) {
+            metrics().get_bytes.add(blob.size());
+            search->found = true;
+            return blob;
+        }
+    }
+    return {};
+}
+
+std::shared_future<size_t> Node::listen(const std::string& code, ListenCallback&& cb) {
+    return node_.listen(dht::InfoHash::get(code),
+        [cb](const std::vector<std::shared_ptr<dht::Value>>& values) {
+            DPASTE_TRACE_THREAD("dht");
+            DPASTE_TRACE_SCOPE("listen values", "dht");
+            for (const auto& v : values)
+                if (not cb(v->data))
+                    return false;
+            return true;
+        }, dht::Value::AllFilter(), dht::Where{}.userType(DPASTE_USER_TYPE)
+    ).share();
+}
+
+void Node::cancel_listen(const std::string& code, std::shared_future<size_t> token) {
+    node_.cancelListen(dht::InfoHash::get(code), token);
+}
+
 } /* dpaste */
 
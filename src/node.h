@@ -23,6 +23,9 @@
 #include <cstdint>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
 
 #include <opendht/dhtrunner.h>
 #include <opendht/value.h>
@@ -34,6 +37,8 @@
 #include "config.h"
 #endif
 
+#include "stats.h"
+
 namespace dpaste {
 #ifdef DPASTE_TEST
 namespace tests { class PirateNodeTester; } /* tests */
@@ -50,21 +55,55 @@ class Node {
 
 public:
     using PastedCallback = std::function<void(std::vector<dht::Blob>)>;
+    /* return false to stop listening */
+    using ListenCallback = std::function<bool(const dht::Blob&)>;
+    /* return true for the blob looked for */
+    using AcceptCallback = std::function<bool(const dht::Blob&)>;
 
     static const constexpr char* DPASTE_USER_TYPE = "dpaste";
+    /*
+     * Values are pasted with a type of their own, kept VALUE_EXPIRATION by the
+     * nodes which know it. Others keep them as long as any value (10 minutes).
+     */
+    static const constexpr uint16_t DPASTE_VALUE_TYPE {0x6470};
+    static const constexpr std::chrono::minutes VALUE_EXPIRATION {60};
 
-    Node() {}
-    virtual ~Node () {}
+    Node() : rand_(std::random_device {}()) {}
+    virtual ~Node () {
+        /* what the destruction of node_ does, timed */
+        if (running_) {
+            Stats::Span span {"shutdown"};
+            node_.join();
+        }
+    }
 
+    /**
+     * Start the node and bootstrap it. This is thread-safe: concurrent callers
+     * block until the first one is done, later calls return immediately. If
+     * the bootstrap hostname is empty, the node starts a network of its own.
+     */
     void run(uint16_t port = 0, std::string bootstrap_hostname = DEFAULT_BOOTSTRAP_NODE, std::string bootstrap_port = DEFAULT_BOOTSTRAP_PORT) {
+        std::lock_guard<std::mutex> lk(run_mtx_);
         if (running_)
             return;
+        Stats::Span span {"node"};
         node_.run(port, dht::crypto::generateIdentity(), true);
-        node_.bootstrap(bootstrap_hostname, bootstrap_port);
+        node_.registerType(dht::ValueType {DPASTE_VALUE_TYPE, DPASTE_USER_TYPE, VALUE_EXPIRATION});
+        if (not bootstrap_hostname.empty())
+            node_.bootstrap(bootstrap_hostname, bootstrap_port);
         running_ = true;
     };
 
+    bool running() const { return running_; }
+
+    /**
+     * @return the UDP port the node is bound to.
+     */
+    in_port_t port() const { return node_.getBoundPort(); }
+
     void stop() {
+        if (not running_)
+            return;
         std::condition_variable cv;
         std::mutex m;
         std::atomic_bool done {false};
@@ -81,12 +120,14 @@ public:
         cv.wait(lk, [&](){ return done.load(); });
 
         node_.join();
+        std::lock_guard<std::mutex> rlk(run_mtx_);
         running_ = false;
     }
 
     /**
-     * Pastes a blob on the DHT under a given code. If no callback, the function
-     * blocks until pasting on the DHT is done.
+     * Pastes a blob on the DHT under a given code, with the id value_id()
+     * gives it. If no callback, the function blocks until pasting on the DHT
+     * is done.
      *
      * @param blob  The blob to paste.
      * @param cb    A function to execute when paste is done. If empty, the
@@ -96,6 +137,40 @@ public:
      */
     bool paste(const std::string& code, dht::Blob&& blob, dht::DoneCallbackSimple&& cb = {});
 
+    /**
+     * Pastes a blob under `replicas` codes derived from a given code (see
+     * replica_code()) so that reading it is spread over as many parts of the
+     * DHT. Blocks until pasting on the DHT is done.
+     *
+     * @param blob      The blob to paste.
+     * @param replicas  The number of replicas.
+     *
+     * @return true if every replica was pasted, else false.
+     */
+    bool paste(const std::string& code, dht::Blob&& blob, unsigned replicas);
+
+    /**
+     * @param code     The code.
+     * @param replica  The index of the replica.
+     *
+     * @return the code under which the replica is stored. The first one is
+     *         the code itself.
+     */
+    static std::string replica_code(const std::string& code, unsigned replica) {
+        return replica ? code+'/'+std::to_string(replica) : code;
+    }
+
+    /**
+     * The id a blob is pasted with, derived from its content. Pasting a blob
+     * again under the same code then refreshes the value already there
+     * instead of adding a copy of it (see Bin::refresh).
+     *
+     * @param blob  The blob.
+     *
+     * @return the id, never dht::Value::INVALID_ID.
+     */
+    static dht::Value::Id value_id(const dht::Blob& blob);
+
     /**
      * Recover a blob under a given code.
      *
@@ -114,13 +189,74 @@ public:
      */
     std::vector<dht::Blob> get(const std::string& code);
 
+    /**
+     * Recover the first acceptable blob under a given code. Blobs are checked
+     * from the calling thread as soon as they are found and the DHT search
+     * stops once one is accepted, without waiting for the search to complete.
+     *
+     * @param code      The code to lookup.
+     * @param accept    Tells whether a blob is usable. If empty, the first
+     *                  blob found is accepted.
+     * @param examined  If set, the number of blobs checked.
+     * @param replicas  The number of replicas the blob may be pasted under.
+     *                  A replica chosen at random is looked up first, then
+     *                  the others in order until one holds an acceptable blob.
+     * @param replica   If set, the index of the replica the blob came from.
+     *
+     * @return the accepted blob. Empty if none is.
+     */
+    dht::Blob get(const std::string& code, const AcceptCallback& accept, size_t* examined = nullptr,
+                  unsigned replicas = 1, unsigned* replica = nullptr);
+
+    /**
+     * @return the number of values stored by this node for the DHT.
+     */
+    size_t stored() const { return node_.getStoreSize().second; }
+
+    /**
+     * @return the number of other nodes known to answer over IPv4.
+     */
+    unsigned peers() const {
+        unsigned good {0};
+        node_.getNodesStats(AF_INET, &good);
+        return good;
+    }
+
+    /**
+     * Listen for blobs under a given code. The callback is called with the
+     * blobs already stored, then with every new blob as soon as it is
+     * announced. It is called from the DHT thread: it must not block on the
+     * DHT.
+     *
+     * @param code  The code to listen to.
+     * @param cb    A function to execute for each blob.
+     *
+     * @return a token for cancel_listen().
+     */
+    std::shared_future<size_t> listen(const std::string& code, ListenCallback&& cb);
+
+    /**
+     * Stop listening.
+     *
+     * @param code   The code listened to.
+     * @param token  The token returned by listen().
+     */
+    void cancel_listen(const std::string& code, std::shared_future<size_t> token);
+
 private:
 
     dht::DhtRunner node_;
-    bool running_ {false};
+    std::mutex run_mtx_;
+    std::atomic_bool running_ {false};
 
     std::uniform_int_distribution<uint32_t> codeDist_;
     std::mt19937_64 rand_;
+    std::mutex rand_mtx_;
+
+    /**
+     * Recover the first acceptable blob under a given code (a single replica).
+     */
+    dht::Blob get_one(const std::string& code, const AcceptCallback& accept, size_t& examined);
 };
 
 } /* dpaste */
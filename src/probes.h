@@ -0,0 +1,80 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*
+ * USDT probes of the "dpaste" provider, for bpftrace, perf or SystemTap. A
+ * probe is a single nop until a tracer attaches to it and needs nothing at
+ * run time. For instance, the latency of DHT gets:
+ *
+ *     bpftrace -e 'usdt:/usr/bin/dpaste:dpaste:node_get_entry { @s[tid] = nsecs; }
+ *                  usdt:/usr/bin/dpaste:dpaste:node_get_return /@s[tid]/ {
+ *                      @ms = hist((nsecs-@s[tid])/1000000); delete(@s[tid]); }'
+ *
+ * Functions have a probe named after them on entry (_entry) and on return
+ * (_return). Entry probes carry the size of the input. Return probes mostly
+ * carry the size of the result, then a result code (rc): 0 on success and -1
+ * on failure, or the HTTP status for the HTTP client. A function leaving by
+ * an exception does not fire its return probe.
+ *
+ *  probe                      arguments
+ *  bin_get_entry              -
+ *  bin_get_return             size of the value found, rc
+ *  bin_paste_entry            size of the data, number of files
+ *  bin_paste_return           rc
+ *  node_paste_entry           size of the blob
+ *  node_paste_return          size of the blob, rc (always 0 when asynchronous)
+ *  node_get_entry             number of replicas
+ *  node_get_return            size of the blob, rc, number of values examined
+ *  http_get_entry             -
+ *  http_get_return            size of the value, HTTP status (-1 on error)
+ *  http_put_entry             size of the value
+ *  http_put_return            size of the value, HTTP status (-1 on error)
+ *  cipher_encrypt_entry       scheme, size of the plain text
+ *  cipher_encrypt_return      size of the cipher text, rc
+ *  cipher_decrypt_entry       scheme, size of the cipher text
+ *  cipher_decrypt_return      size of the plain text, rc
+ *  packet_serialize_entry     size of the data
+ *  packet_serialize_return    size of the buffer
+ *  packet_deserialize_entry   size of the buffer
+ *  packet_deserialize_return  size of the data, number of parts
+ *
+ * Probes are built when <sys/sdt.h> is found at configure time. Otherwise,
+ * the macros expand to nothing.
+ */
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define DPASTE_PROBE(name) DTRACE_PROBE(dpaste, name)
+#define DPASTE_PROBE1(name, a) DTRACE_PROBE1(dpaste, name, a)
+#define DPASTE_PROBE2(name, a, b) DTRACE_PROBE2(dpaste, name, a, b)
+#define DPASTE_PROBE3(name, a, b, c) DTRACE_PROBE3(dpaste, name, a, b, c)
+#else
+#define DPASTE_PROBE(name)
+#define DPASTE_PROBE1(name, a)
+#define DPASTE_PROBE2(name, a, b)
+#define DPASTE_PROBE3(name, a, b, c)
+#endif
+
+/* vim:set et sw=4 ts=4 tw=120: */
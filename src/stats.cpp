@@ -0,0 +1,161 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <mutex>
+#include <atomic>
+#include <iomanip>
+#include <ctime>
+#include <algorithm>
+
+#include <nlohmann/json.hpp>
+
+#include "stats.h"
+#include "trace.h"
+
+namespace dpaste {
+
+namespace {
+
+std::atomic_bool enabled_ {false};
+std::mutex mtx_;
+std::vector<Stats::Stage> stages_;
+std::chrono::steady_clock::time_point start_;
+
+double ms(std::chrono::nanoseconds d) { return std::chrono::duration<double, std::milli>(d).count(); }
+
+std::chrono::nanoseconds clock_time(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+} /* anonymous namespace */
+
+Stats::Span::Span(const char* stage, uint64_t bytes_in) : stage_(stage), in_(bytes_in) {
+#ifdef DPASTE_TRACE
+    Trace::begin(stage_, "stage", in_);
+#endif
+    if (not enabled_)
+        return;
+    wall_ = std::chrono::steady_clock::now();
+    cpu_ = thread_cpu();
+    allocs_ = Alloc::thread();
+}
+
+Stats::Span::~Span() {
+#ifdef DPASTE_TRACE
+    Trace::end(stage_, "stage");
+#endif
+    if (not enabled_ or wall_ == std::chrono::steady_clock::time_point {})
+        return;
+    record(stage_, std::chrono::steady_clock::now()-wall_, thread_cpu()-cpu_, in_, out_, Alloc::thread()-allocs_);
+}
+
+void Stats::enable() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    start_ = std::chrono::steady_clock::now();
+    enabled_ = true;
+    Alloc::enable();
+}
+
+bool Stats::enabled() {
+    return enabled_;
+}
+
+std::chrono::nanoseconds Stats::thread_cpu() {
+    return clock_time(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void Stats::record(const char* stage, std::chrono::nanoseconds wall, std::chrono::nanoseconds cpu,
+                   uint64_t bytes_in, uint64_t bytes_out, const Alloc::Counts& allocs)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto s = std::find_if(stages_.begin(), stages_.end(), [&](const Stage& s) { return s.name == stage; });
+    if (s == stages_.end())
+        s = stages_.insert(s, Stage {stage});
+    ++s->calls;
+    s->wall += wall;
+    s->cpu += cpu;
+    s->bytes_in += bytes_in;
+    s->bytes_out += bytes_out;
+    s->allocs += allocs.allocs;
+    s->alloc_bytes += allocs.bytes;
+}
+
+std::vector<Stats::Stage> Stats::stages() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return stages_;
+}
+
+void Stats::report(std::ostream& out, bool json) {
+    const auto stages = Stats::stages();
+    std::chrono::nanoseconds wall {0};
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        wall = std::chrono::steady_clock::now()-start_;
+    }
+    const auto cpu = clock_time(CLOCK_PROCESS_CPUTIME_ID);
+    const auto allocs = Alloc::process();
+    const auto rss = Alloc::peak_rss();
+
+    if (json) {
+        auto j = nlohmann::json::object();
+        j["wall_ms"] = ms(wall);
+        j["cpu_ms"] = ms(cpu);
+        j["allocs"] = allocs.allocs;
+        j["alloc_bytes"] = allocs.bytes;
+        j["peak_rss"] = rss;
+        j["stages"] = nlohmann::json::array();
+        for (const auto& s : stages)
+            j["stages"].push_back({
+                {"name",        s.name},
+                {"calls",       s.calls},
+                {"wall_ms",     ms(s.wall)},
+                {"cpu_ms",      ms(s.cpu)},
+                {"bytes_in",    s.bytes_in},
+                {"bytes_out",   s.bytes_out},
+                {"allocs",      s.allocs},
+                {"alloc_bytes", s.alloc_bytes}
+            });
+        out << j.dump() << std::endl;
+        return;
+    }
+
+    const auto flags = out.flags();
+    out << std::left << std::setw(12) << "stage" << std::right
+        << std::setw(8) << "calls" << std::setw(12) << "wall (ms)" << std::setw(12) << "cpu (ms)"
+        << std::setw(12) << "bytes in" << std::setw(12) << "bytes out"
+        << std::setw(10) << "allocs" << std::setw(14) << "alloc bytes" << std::endl;
+    out << std::fixed << std::setprecision(3);
+    for (const auto& s : stages)
+        out << std::left << std::setw(12) << s.name << std::right
+            << std::setw(8) << s.calls << std::setw(12) << ms(s.wall) << std::setw(12) << ms(s.cpu)
+            << std::setw(12) << s.bytes_in << std::setw(12) << s.bytes_out
+            << std::setw(10) << s.allocs << std::setw(14) << s.alloc_bytes << std::endl;
+    out << std::left << std::setw(12) << "total" << std::right
+        << std::setw(8) << "" << std::setw(12) << ms(wall) << std::setw(12) << ms(cpu)
+        << std::setw(24) << "" << std::setw(10) << allocs.allocs << std::setw(14) << allocs.bytes << std::endl;
+    out << "peak RSS: " << rss/1024 << " kB" << std::endl;
+    out.flags(flags);
+}
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
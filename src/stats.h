@@ -0,0 +1,111 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <chrono>
+#include <cstdint>
+
+#include "alloc.h"
+
+namespace dpaste {
+
+/**
+ * Time spent and bytes handled by each stage of a run (see --stats). Stages
+ * are timed by Stats::Span from any thread: spans of the same stage add up,
+ * even when they overlap. CPU time is the one of the thread running the span,
+ * so the work of the DHT thread only shows in the total.
+ *
+ * Nothing is recorded unless enabled, which keeps spans nearly free.
+ * When built with tracing, spans are also trace events (see Trace). Heap
+ * allocations are counted like CPU time, per thread (see Alloc).
+ */
+class Stats {
+public:
+    struct Stage {
+        std::string name;
+        uint64_t calls {0};
+        std::chrono::nanoseconds wall {0};
+        std::chrono::nanoseconds cpu {0};
+        uint64_t bytes_in {0};
+        uint64_t bytes_out {0};
+        uint64_t allocs {0};
+        uint64_t alloc_bytes {0};
+    };
+
+    /**
+     * Times a stage from its construction to its destruction.
+     */
+    class Span {
+    public:
+        /**
+         * @param stage     The name of the stage. It must outlive the span.
+         * @param bytes_in  The number of bytes the stage is given.
+         */
+        Span(const char* stage, uint64_t bytes_in = 0);
+        ~Span();
+
+        void bytes_in(uint64_t bytes) { in_ = bytes; }
+        void bytes_out(uint64_t bytes) { out_ = bytes; }
+
+    private:
+        const char* stage_;
+        uint64_t in_;
+        uint64_t out_ {0};
+        std::chrono::steady_clock::time_point wall_ {};
+        std::chrono::nanoseconds cpu_ {0};
+        Alloc::Counts allocs_ {};
+    };
+
+    /**
+     * Start recording, along with heap allocations. The total wall time is
+     * counted from here.
+     */
+    static void enable();
+    static bool enabled();
+
+    /**
+     * @return the stages, in the order they were first recorded.
+     */
+    static std::vector<Stage> stages();
+
+    /**
+     * Write a report of every stage along with the total wall and CPU time,
+     * heap allocations and peak resident set size of the process.
+     *
+     * @param out   The stream to write to.
+     * @param json  Whether to write JSON rather than a table.
+     */
+    static void report(std::ostream& out, bool json = false);
+
+    /* CPU time of the calling thread */
+    static std::chrono::nanoseconds thread_cpu();
+
+private:
+    static void record(const char* stage, std::chrono::nanoseconds wall, std::chrono::nanoseconds cpu,
+                       uint64_t bytes_in, uint64_t bytes_out, const Alloc::Counts& allocs);
+};
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
@@ -0,0 +1,145 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <fstream>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <nlohmann/json.hpp>
+
+#include "trace.h"
+
+namespace dpaste {
+
+namespace {
+
+struct Event {
+    char ph;
+    const char* name;
+    const char* cat;
+    std::chrono::steady_clock::duration ts;
+    long tid;
+    uint64_t id;
+    uint64_t bytes;
+};
+
+std::atomic_bool enabled_ {false};
+std::mutex mtx_;
+std::vector<Event> events_;
+std::string path_;
+std::chrono::steady_clock::time_point start_;
+
+long tid() {
+    thread_local const long id = syscall(SYS_gettid);
+    return id;
+}
+
+void add(char ph, const char* name, const char* cat, uint64_t id = 0, uint64_t bytes = 0) {
+    if (not enabled_)
+        return;
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lk(mtx_);
+    events_.push_back({ph, name, cat, now-start_, tid(), id, bytes});
+}
+
+} /* anonymous namespace */
+
+void Trace::start(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        path_ = path;
+        events_.clear();
+        start_ = std::chrono::steady_clock::now();
+        enabled_ = true;
+    }
+    name_thread("main");
+}
+
+bool Trace::enabled() {
+    return enabled_;
+}
+
+bool Trace::stop() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (not enabled_)
+        return false;
+    enabled_ = false;
+
+    const auto pid = getpid();
+    auto trace = nlohmann::json::array();
+    for (const auto& e : events_) {
+        nlohmann::json j = {
+            {"ph",  std::string(1, e.ph)},
+            {"pid", pid},
+            {"tid", e.tid},
+            {"ts",  std::chrono::duration<double, std::micro>(e.ts).count()}
+        };
+        if (e.ph == 'M') {
+            j["name"] = "thread_name";
+            j["args"] = {{"name", e.name}};
+        } else {
+            j["name"] = e.name;
+            j["cat"] = e.cat;
+        }
+        if (e.ph == 'b' or e.ph == 'e')
+            j["id"] = e.id;
+        if (e.bytes)
+            j["args"] = {{"bytes", e.bytes}};
+        trace.push_back(j);
+    }
+    events_.clear();
+
+    std::ofstream out(path_);
+    out << nlohmann::json {{"traceEvents", trace}, {"displayTimeUnit", "ms"}}.dump() << std::endl;
+    return bool(out);
+}
+
+void Trace::begin(const char* name, const char* cat, uint64_t bytes) {
+    add('B', name, cat, 0, bytes);
+}
+
+void Trace::end(const char* name, const char* cat) {
+    add('E', name, cat);
+}
+
+void Trace::async_begin(const char* name, const char* cat, uint64_t id) {
+    add('b', name, cat, id);
+}
+
+void Trace::async_end(const char* name, const char* cat, uint64_t id) {
+    add('e', name, cat, id);
+}
+
+void Trace::name_thread(const char* name) {
+    thread_local bool named {false};
+    if (named or not enabled_)
+        return;
+    named = true;
+    add('M', name, "");
+}
+
+} /* dpaste */
+
+/* vim:set et sw=4 ts=4 tw=120: */
@@ -0,0 +1,127 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+namespace dpaste {
+
+/**
+ * Chrome trace events (see --trace), to be loaded in chrome://tracing or
+ * Perfetto. Events are kept in memory with the thread they happened on and
+ * written at once by stop().
+ *
+ * Code is instrumented through the DPASTE_TRACE_* macros below, which expand
+ * to nothing unless dpaste is built with tracing (--enable-trace or the
+ * DPASTE_TRACE CMake option).
+ */
+class Trace {
+public:
+    /**
+     * A begin event on construction and the matching end event on
+     * destruction.
+     */
+    class Scope {
+    public:
+        /**
+         * @param name   The name of the event. It must outlive the scope.
+         * @param cat    The category of the event. It must outlive the scope.
+         * @param bytes  If not zero, recorded with the begin event.
+         */
+        Scope(const char* name, const char* cat, uint64_t bytes = 0) : name_(name), cat_(cat) {
+            begin(name_, cat_, bytes);
+        }
+        ~Scope() { end(name_, cat_); }
+
+    private:
+        const char* name_;
+        const char* cat_;
+    };
+
+    /**
+     * @return whether dpaste was built with tracing.
+     */
+    static constexpr bool available() {
+#ifdef DPASTE_TRACE
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * Start recording events, which stop() will write to a given file. The
+     * calling thread is named "main".
+     */
+    static void start(const std::string& path);
+    static bool enabled();
+
+    /**
+     * Stop recording and write the events recorded so far.
+     *
+     * @return true if the file was written, else false.
+     */
+    static bool stop();
+
+    static void begin(const char* name, const char* cat, uint64_t bytes = 0);
+    static void end(const char* name, const char* cat);
+
+    /**
+     * Events of an operation which ends on another thread than the one it
+     * began on, like a DHT request answered on the DHT thread.
+     *
+     * @param id  Tells apart concurrent operations of the same name. The
+     *            macros use the address of some state of the operation.
+     */
+    static void async_begin(const char* name, const char* cat, uint64_t id);
+    static void async_end(const char* name, const char* cat, uint64_t id);
+
+    /**
+     * Name the calling thread in the trace. Only the first call per thread
+     * has an effect.
+     */
+    static void name_thread(const char* name);
+};
+
+} /* dpaste */
+
+#ifdef DPASTE_TRACE
+#define DPASTE_TRACE_CONCAT_(a, b) a##b
+#define DPASTE_TRACE_CONCAT(a, b) DPASTE_TRACE_CONCAT_(a, b)
+#define DPASTE_TRACE_SCOPE(...) ::dpaste::Trace::Scope DPASTE_TRACE_CONCAT(trace_scope_, __LINE__) {__VA_ARGS__}
+#define DPASTE_TRACE_ASYNC_BEGIN(name, cat, ptr) \
+    ::dpaste::Trace::async_begin(name, cat, reinterpret_cast<uintptr_t>(ptr))
+#define DPASTE_TRACE_ASYNC_END(name, cat, ptr) \
+    ::dpaste::Trace::async_end(name, cat, reinterpret_cast<uintptr_t>(ptr))
+#define DPASTE_TRACE_THREAD(name) ::dpaste::Trace::name_thread(name)
+#else
+#define DPASTE_TRACE_SCOPE(...)
+#define DPASTE_TRACE_ASYNC_BEGIN(name, cat, ptr)
+#define DPASTE_TRACE_ASYNC_END(name, cat, ptr)
+#define DPASTE_TRACE_THREAD(name)
+#endif
+
+/* vim:set et sw=4 ts=4 tw=120: */
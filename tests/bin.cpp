@@ -19,11 +19,19 @@
  */
 
 #include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <set>
 
 #include <catch2/catch.hpp>
 
 #include "tests.h"
+#include "cluster.h"
+#include "proxy.h"
+#include "keyring.h"
 #include "bin.h"
+#include "keeper.h"
+#include "alloc.h"
 
 namespace dpaste {
 namespace tests {
@@ -44,12 +52,133 @@ public:
     std::vector<uint8_t> data_from_stream(std::stringstream&& input_stream) const {
         return Bin::data_from_stream(std::forward<std::stringstream>(input_stream));
     }
+
+    std::string random_pin() const { return Bin::random_pin(); }
+
+    /* whether the paste of the given code is in the spool (see Bin::set_queue) */
+    bool spooled(const std::string& code) const {
+        return std::ifstream(Keeper::spool_dir()+'/'+Bin::code_from_dpaste_uri(code)).is_open();
+    }
+
+    bool node_running(const Bin& bin) const { return bin.node.running(); }
+
+    /* whether the node was started at the hedge deadline, once it is */
+    bool node_hedged(Bin& bin) const {
+        std::lock_guard<std::mutex> lk(bin.node_start_mtx_);
+        if (not bin.node_start_.valid())
+            return false;
+        bin.node_start_.wait();
+        return bin.node.running();
+    }
+
+    static constexpr std::chrono::milliseconds node_hedge_delay() { return Bin::NODE_HEDGE_DELAY; }
+
+    /* publish a packet listing more parts than a value holds, under code */
+    std::string publish_oversized(Bin& bin, const std::string& code) const {
+        Bin::Packet p;
+        p.parts.assign(dht::MAX_VALUE_SIZE/sizeof(crypto::Merkle::Digest)+1, crypto::Merkle::leaf({0}));
+        p.root = crypto::Merkle::root(p.parts);
+        std::vector<std::vector<uint8_t>> parts (p.parts.size(), std::vector<uint8_t> {0});
+        return bin.publish({std::move(p), ""}, std::move(parts), code);
+    }
+
+    /* get the paste of uri after altering its packet, as a forger would */
+    bool get_forged(Bin& bin, const std::string& uri, std::ostream& out) const {
+        const auto code = Bin::code_from_dpaste_uri(uri);
+        Bin::Packet p;
+        p.deserialize(bin.fetch(code));
+        if (p.parts.empty())
+            p.data.back() ^= 1;
+        else {
+            p.parts.back().back() ^= 1;
+            p.root = crypto::Merkle::root(p.parts);
+        }
+        return bin.write_value(p.serialize(), code, out, false);
+    }
+
+    /* store under code a single value which is refused, and a streamed one holding data */
+    bool store_shadowed(Bin& bin, const std::string& code, const std::vector<uint8_t>& data) const {
+        Bin::Packet refused, streamed;
+        refused.data = {0, 1, 2};
+        refused.signature = {0};
+        refused.sighash = "md5";
+        refused.tag = Bin::code_tag(code);
+        streamed.streamed = true;
+        streamed.eof = true;
+        streamed.data = data;
+        streamed.tag = Bin::code_tag(code);
+        return bin.store(code, refused.serialize()) and bin.store(code, streamed.serialize());
+    }
+
+    static constexpr size_t part_size() { return Bin::PART_SIZE; }
+    static constexpr size_t stream_batch_size() { return Bin::STREAM_BATCH_SIZE; }
+    static constexpr uint64_t stream_segment_size() { return Bin::STREAM_SEGMENT_SIZE; }
+
+    std::vector<crypto::Merkle::Digest> packet_round_trip(const std::vector<uint8_t>& data) const {
+        Bin::Packet p, rp;
+        p.scheme = crypto::Cipher::Scheme::AES;
+        p.salt = {1, 2, 3};
+        p.size = data.size();
+        for (size_t i = 0; i < data.size(); ++i)
+            p.parts.emplace_back(crypto::Merkle::leaf({data[i]}));
+        p.root = crypto::Merkle::root(p.parts);
+        p.chunks = p.parts;
+
+        rp.deserialize(p.serialize());
+        if (rp.root != p.root or rp.size != p.size or rp.scheme != p.scheme or rp.salt != p.salt
+                or rp.chunks != p.chunks)
+            return {};
+        return rp.parts;
+    }
+
+    /* archive index round trip, and whether the signed manifest covers it */
+    bool index_round_trip() const {
+        Bin::Packet p, rp;
+        p.parts = {crypto::Merkle::leaf({0}), crypto::Merkle::leaf({1})};
+        p.root = crypto::Merkle::root(p.parts);
+        p.size = 10;
+        p.sizes = {4, 6};
+        p.files = {{"a.log", 0, 3}, {"b.log", 3, 7}};
+
+        rp.deserialize(p.serialize());
+        if (rp.sizes != p.sizes or rp.files.size() != p.files.size() or rp.manifest() != p.manifest()
+                or rp.manifest_hash() != std::string {Bin::MERKLE_INDEX_HASH})
+            return false;
+        for (size_t i = 0; i < p.files.size(); ++i)
+            if (rp.files[i].name != p.files[i].name or rp.files[i].offset != p.files[i].offset
+                    or rp.files[i].size != p.files[i].size)
+                return false;
+        rp.files[1].name = "c.log";
+        return rp.manifest() != p.manifest();
+    }
+
+    bool tag_round_trip(const std::string& code, const std::string& other) const {
+        Bin::Packet p, rp;
+        p.data = {0, 1, 2};
+        p.tag = Bin::code_tag(code);
+        rp.deserialize(p.serialize());
+        Bin::Packet untagged;
+        return rp.tag.size() == Bin::TAG_LEN and Bin::tagged_for(rp, code) and not Bin::tagged_for(rp, other)
+            and Bin::tagged_for(untagged, other);
+    }
+
+    bool stream_round_trip() const {
+        Bin::Packet p, rp;
+        p.streamed = true;
+        p.seq = 70;
+        p.eof = true;
+        p.data = {0, 1, 2};
+        rp.deserialize(p.serialize());
+        return rp.streamed and rp.seq == p.seq and rp.eof and rp.data == p.data
+            and Bin::stream_code("abcd", 0) == "abcd" and Bin::stream_code("abcd", 1) != "abcd";
+    }
 };
 
 TEST_CASE("Bin get/paste on DHT", "[Bin][get][paste]") {
     using pbt = PirateBinTester;
+    PirateBinTester pt;
     std::vector<uint8_t> data = {0, 1, 2, 3, 4};
-    Bin bin {};
+    Bin bin {Cluster::shared().options()};
     crypto::Cipher::init();
     SECTION ( "pasting data {0,1,2,3,4}" ) {
         auto code = bin.paste(std::vector<uint8_t> {data}, {});
@@ -61,6 +190,38 @@ TEST_CASE("Bin get/paste on DHT", "[Bin][get][paste]") {
             REQUIRE ( data == rdv );
         }
     }
+    SECTION ( "queuing data spanning several values" ) {
+        std::vector<uint8_t> big_data (2*pbt::part_size()+1);
+        for (auto& b : big_data)
+            b = random_number();
+        bin.set_queue(true);
+        auto code = bin.paste(std::vector<uint8_t> {big_data}, {});
+        bin.set_queue(false);
+        REQUIRE ( code.size() == pbt::LOCATION_CODE_LEN+sizeof(pbt::DPASTE_URI_PREFIX)-1 );
+        REQUIRE ( pt.spooled(code) );
+        REQUIRE ( Bin::queued() >= 1 );
+
+        SECTION ( "publishing the queued paste and getting it back" ) {
+            REQUIRE ( bin.flush() );
+            REQUIRE ( not pt.spooled(code) );
+            auto rd = bin.get(std::move(code)).second;
+            std::vector<uint8_t> rdv {rd.begin(), rd.end()};
+            REQUIRE ( big_data == rdv );
+        }
+    }
+    SECTION ( "getting a value stored along with a refused one" ) {
+        const auto pin = pt.random_pin();
+        REQUIRE ( pt.store_shadowed(bin, pin, data) );
+        auto rd = bin.get(std::string {pin}).second;
+        REQUIRE ( std::vector<uint8_t> {rd.begin(), rd.end()} == data );
+    }
+    SECTION ( "refusing a paste listing too many parts before storing any" ) {
+        const auto pin = pt.random_pin();
+        bin.set_queue(true);
+        REQUIRE ( pt.publish_oversized(bin, pin).empty() );
+        REQUIRE ( not pt.spooled(pin) );
+        REQUIRE ( not std::ifstream(Keeper::spool_dir()+'/'+pin+".part").is_open() );
+    }
     SECTION ( "pasting AES encrypted {0,1,2,3,4}" ) {
         auto p = std::make_unique<dpaste::crypto::Parameters>();
         p->emplace<crypto::AESParameters>();
@@ -73,6 +234,249 @@ TEST_CASE("Bin get/paste on DHT", "[Bin][get][paste]") {
             REQUIRE ( data == rdv );
         }
     }
+    SECTION ( "pasting data spanning several values" ) {
+        std::vector<uint8_t> big_data (3*pbt::part_size()+1);
+        for (auto& b : big_data)
+            b = random_number();
+        auto code = bin.paste(std::vector<uint8_t> {big_data}, {});
+        REQUIRE ( code.size() == pbt::LOCATION_CODE_LEN+sizeof(pbt::DPASTE_URI_PREFIX)-1 );
+
+        SECTION ( "getting the parts back from the DHT" ) {
+            auto rd = bin.get(std::move(code)).second;
+            std::vector<uint8_t> rdv {rd.begin(), rd.end()};
+            REQUIRE ( big_data == rdv );
+        }
+    }
+    SECTION ( "pasting data spanning several values with parity values" ) {
+        std::vector<uint8_t> big_data (3*pbt::part_size()+1);
+        for (auto& b : big_data)
+            b = random_number();
+        bin.set_parity(2);
+        auto code = bin.paste(std::vector<uint8_t> {big_data}, {});
+        bin.set_parity(0);
+        REQUIRE ( code.size() == pbt::LOCATION_CODE_LEN+sizeof(pbt::DPASTE_URI_PREFIX)-1 );
+
+        SECTION ( "getting the erasure coded parts back from the DHT" ) {
+            auto rd = bin.get(std::move(code)).second;
+            std::vector<uint8_t> rdv {rd.begin(), rd.end()};
+            REQUIRE ( big_data == rdv );
+        }
+    }
+    SECTION ( "pasting an archive of several files" ) {
+        std::vector<uint8_t> a (pbt::part_size()/2), b (3*pbt::part_size());
+        for (auto& x : a)
+            x = random_number();
+        for (auto& x : b)
+            x = random_number();
+        std::vector<std::pair<std::string, std::vector<uint8_t>>> files {{"a.log", a}, {"b.log", b}};
+        auto p = std::make_unique<dpaste::crypto::Parameters>();
+        p->emplace<crypto::AESParameters>();
+        auto code = bin.paste(std::move(files), std::move(p));
+        REQUIRE ( code.size() == 2*pbt::LOCATION_CODE_LEN+sizeof(pbt::DPASTE_URI_PREFIX)-1 );
+
+        SECTION ( "listing the files" ) {
+            auto rd = bin.get(std::move(code)).second;
+            REQUIRE ( rd == std::to_string(a.size())+"\ta.log\n"+std::to_string(b.size())+"\tb.log\n" );
+        }
+        SECTION ( "extracting a file" ) {
+            std::ostringstream oss;
+            REQUIRE ( bin.extract(std::move(code), oss, "b.log") );
+            auto rd = oss.str();
+            REQUIRE ( std::vector<uint8_t> {rd.begin(), rd.end()} == b );
+        }
+        SECTION ( "extracting a range of a file" ) {
+            const size_t offset = pbt::part_size()+7, length = pbt::part_size();
+            std::ostringstream oss;
+            REQUIRE ( bin.extract(std::move(code), oss, "b.log", offset, length) );
+            auto rd = oss.str();
+            REQUIRE ( std::vector<uint8_t> {rd.begin(), rd.end()}
+                    == std::vector<uint8_t> {b.begin()+offset, b.begin()+offset+length} );
+        }
+        SECTION ( "extracting a missing file" ) {
+            std::ostringstream oss;
+            REQUIRE ( not bin.extract(std::move(code), oss, "c.log") );
+        }
+    }
+    SECTION ( "streaming lines and following them" ) {
+        std::string lines;
+        /* one value per line, spanning two segments of the stream */
+        for (size_t i = 0; i < pbt::stream_segment_size()+2; ++i)
+            lines += std::string(pbt::stream_batch_size()-1, 'a'+i%26) + '\n';
+        std::istringstream in {lines};
+        auto p = std::make_unique<dpaste::crypto::Parameters>();
+        p->emplace<crypto::AESParameters>();
+        std::string code;
+        REQUIRE ( bin.stream(in, std::move(p), [&](const std::string& c) { code = c; }) );
+
+        std::ostringstream out;
+        REQUIRE ( bin.follow(std::move(code), out) );
+        REQUIRE ( out.str() == lines );
+    }
+    SECTION ( "pasting AES encrypted data spanning several values" ) {
+        std::vector<uint8_t> big_data (2*pbt::part_size()+1);
+        for (auto& b : big_data)
+            b = random_number();
+        auto p = std::make_unique<dpaste::crypto::Parameters>();
+        p->emplace<crypto::AESParameters>();
+        auto code = bin.paste(std::vector<uint8_t> {big_data}, std::move(p));
+        REQUIRE ( code.size() == 2*pbt::LOCATION_CODE_LEN+sizeof(pbt::DPASTE_URI_PREFIX)-1 );
+
+        SECTION ( "getting the AES encrypted parts back from the DHT" ) {
+            auto rd = bin.get(std::move(code)).second;
+            std::vector<uint8_t> rdv {rd.begin(), rd.end()};
+            REQUIRE ( big_data == rdv );
+        }
+        SECTION ( "updating the AES encrypted data after an edit" ) {
+            const std::string LINE {"edited line\n"};
+            big_data.insert(big_data.begin()+big_data.size()/2, LINE.begin(), LINE.end());
+            auto up = std::make_unique<dpaste::crypto::Parameters>();
+            up->emplace<crypto::AESParameters>();
+            auto new_code = bin.update(std::string {code}, std::vector<uint8_t> {big_data}, std::move(up));
+            REQUIRE ( new_code.size() == code.size() );
+            REQUIRE ( new_code.substr(new_code.size()-pbt::LOCATION_CODE_LEN)
+                    == code.substr(code.size()-pbt::LOCATION_CODE_LEN) );
+
+            auto rd = bin.get(std::move(new_code)).second;
+            std::vector<uint8_t> rdv {rd.begin(), rd.end()};
+            REQUIRE ( big_data == rdv );
+        }
+    }
+}
+
+TEST_CASE("Bin over a faulty HTTP proxy", "[Bin][get][paste][proxy]") {
+    using pbt = PirateBinTester;
+    PirateBinTester pt;
+    const std::vector<uint8_t> data = {0, 1, 2, 3, 4};
+    Proxy proxy {Cluster::shared().bootstrap()};
+    auto options = Cluster::shared().options();
+    options["port"] = std::to_string(proxy.port());
+    Bin bin {options};
+    auto get = [&](std::string&& code) {
+        auto rd = bin.get(std::move(code)).second;
+        return std::vector<uint8_t> {rd.begin(), rd.end()};
+    };
+    Proxy::Faults faults;
+
+    SECTION ( "a working proxy spares the DHT node" ) {
+        auto code = bin.paste(std::vector<uint8_t> {data}, {});
+        REQUIRE ( proxy.stored() == 1 );
+        REQUIRE ( get(std::move(code)) == data );
+        REQUIRE ( proxy.gets() == 1 );
+        REQUIRE ( not pt.node_running(bin) );
+    }
+    SECTION ( "errors fall back to the DHT node" ) {
+        faults.status = 500;
+        proxy.set_faults(faults);
+        auto code = bin.paste(std::vector<uint8_t> {data}, {});
+        REQUIRE ( proxy.stored() == 0 );
+        REQUIRE ( pt.node_running(bin) );
+        REQUIRE ( get(std::move(code)) == data );
+    }
+    SECTION ( "truncated responses fall back to the DHT node" ) {
+        auto code = bin.paste(std::vector<uint8_t> {data}, {});
+        faults.truncate = true;
+        proxy.set_faults(faults);
+        REQUIRE ( get(std::move(code)) == data );
+        REQUIRE ( proxy.gets() == 1 );
+        REQUIRE ( pt.node_running(bin) );
+    }
+    SECTION ( "a slow proxy starts the DHT node at the hedge deadline" ) {
+        faults.latency = 2*pbt::node_hedge_delay();
+        proxy.set_faults(faults);
+        auto code = bin.paste(std::vector<uint8_t> {data}, {});
+        REQUIRE ( proxy.stored() == 1 );
+        REQUIRE ( pt.node_hedged(bin) );
+        REQUIRE ( get(std::move(code)) == data );
+    }
+}
+
+TEST_CASE("Bin signed pastes", "[Bin][get][paste][GPG]") {
+    PirateBinTester pt;
+    const auto& key = TestKeyring::key();
+    REQUIRE ( not key.empty() );
+    auto options = Cluster::shared().options();
+    options["pgp_key_id"] = key;
+    Bin bin {options};
+    auto sign = []() {
+        auto p = std::make_unique<dpaste::crypto::Parameters>();
+        p->emplace<crypto::GPGParameters>(std::vector<std::string> {}, false, true);
+        return p;
+    };
+    auto get = [&](std::string code, bool forged) {
+        std::ostringstream out;
+        const auto success = forged ? pt.get_forged(bin, code, out) : bin.get(std::move(code), out, false);
+        return std::make_pair(success, out.str());
+    };
+    std::vector<uint8_t> data (GENERATE(size_t {5}, 2*PirateBinTester::part_size()+1));
+    for (auto& b : data)
+        b = random_number();
+    const std::string sdata {data.begin(), data.end()};
+    const auto code = bin.paste(std::vector<uint8_t> {data}, sign());
+    REQUIRE ( not code.empty() );
+
+    /* the same rule whether the paste spans one value or several */
+    SECTION ( "a good signature is accepted" ) {
+        REQUIRE ( get(code, false) == std::make_pair(true, sdata) );
+    }
+    SECTION ( "a good signature from a key not certified is accepted" ) {
+        TestKeyring::trust(false);
+        const auto got = get(code, false);
+        TestKeyring::trust(true);
+        REQUIRE ( got == std::make_pair(true, sdata) );
+    }
+    SECTION ( "a bad signature is refused, and nothing is written" ) {
+        REQUIRE ( get(code, true) == std::make_pair(false, std::string {}) );
+    }
+}
+
+TEST_CASE("Bin allocations of a 64KB paste", "[Bin][paste][Alloc]") {
+    using pbt = PirateBinTester;
+    std::vector<uint8_t> data (64*1024);
+    for (auto& b : data)
+        b = random_number();
+    Bin bin {Cluster::shared().options()};
+    /*
+     * Queued, so that only dpaste's own work is counted, in the calling thread
+     * only: the threads of the DHT nodes of other tests allocate meanwhile.
+     * The workers of Bin::store_parts only append the parts to the spool.
+     */
+    bin.set_queue(true);
+    const auto was_enabled = Alloc::enabled();
+    Alloc::enable();
+    const auto before = Alloc::thread();
+    auto code = bin.paste(std::move(data), {});
+    const auto used = Alloc::thread()-before;
+    if (not was_enabled)
+        Alloc::disable();
+    REQUIRE ( code.size() == pbt::LOCATION_CODE_LEN+sizeof(pbt::DPASTE_URI_PREFIX)-1 );
+    std::remove((Keeper::spool_dir()+'/'+pbt().code_from_dpaste_uri(code)).c_str());
+
+    /*
+     * A handful of copies of the data and a few allocations per part. An
+     * allocation per byte or a copy of the data per part exceeds these.
+     */
+    REQUIRE ( used.allocs < 2000 );
+    REQUIRE ( used.bytes < 32*64*1024 );
+}
+
+TEST_CASE("Bin packet serialization of parts", "[Bin][Packet][serialize][deserialize]") {
+    PirateBinTester pt;
+    std::vector<uint8_t> data {0, 1, 2, 3, 4};
+    auto parts = pt.packet_round_trip(data);
+    REQUIRE ( parts.size() == data.size() );
+    for (size_t i = 0; i < data.size(); ++i)
+        REQUIRE ( parts[i] == crypto::Merkle::leaf({data[i]}) );
+
+    SECTION ( "archive index" ) {
+        REQUIRE ( pt.index_round_trip() );
+    }
+    SECTION ( "stream values" ) {
+        REQUIRE ( pt.stream_round_trip() );
+    }
+    SECTION ( "code tag" ) {
+        const auto lcode = random_pin();
+        REQUIRE ( pt.tag_round_trip(lcode+random_pin(), lcode+random_pin()) );
+    }
 }
 
 TEST_CASE("Bin parsing of uri code ([dpaste:]XXXXXXXX)", "[Bin][code_from_dpaste_uri]") {
@@ -120,6 +524,17 @@ TEST_CASE("Bin conversion of stringstream to vector", "[Bin][data_from_stream]")
     REQUIRE ( pt.data_from_stream(std::move(ss)) == d );
 }
 
+TEST_CASE("Bin random pins", "[Bin][random_pin]") {
+    PirateBinTester pt;
+    std::set<std::string> pins;
+    for (unsigned i = 0; i < 64; ++i) {
+        auto pin = pt.random_pin();
+        REQUIRE ( pin.size() == Bin::DPASTE_PIN_LEN );
+        pins.emplace(std::move(pin));
+    }
+    REQUIRE ( pins.size() == 64 );
+}
+
 } /* tests */
 } /* dpaste */
 
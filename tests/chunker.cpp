@@ -0,0 +1,78 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <set>
+
+#include <catch2/catch.hpp>
+
+#include "tests.h"
+#include "chunker.h"
+
+namespace dpaste {
+namespace tests {
+
+TEST_CASE("Chunker content-defined boundaries", "[Chunker][split][cut]") {
+    const size_t MIN = 2*1024, AVG = 8*1024, MAX = 32*1024;
+    Chunker chunker {MIN, AVG, MAX};
+    std::vector<uint8_t> data (512*1024);
+    for (auto& b : data)
+        b = random_number();
+
+    auto ends = chunker.split(data);
+    REQUIRE ( ends.back() == data.size() );
+
+    SECTION ( "chunk sizes are within bounds" ) {
+        size_t begin = 0;
+        for (size_t i = 0; i < ends.size(); ++i) {
+            const auto size = ends[i]-begin;
+            REQUIRE ( size <= MAX );
+            if (i+1 < ends.size())
+                REQUIRE ( size >= MIN );
+            begin = ends[i];
+        }
+    }
+    SECTION ( "an insertion only changes nearby chunks" ) {
+        auto edited = data;
+        const std::vector<uint8_t> line {'h', 'e', 'l', 'l', 'o', '\n'};
+        edited.insert(edited.begin()+data.size()/2, line.begin(), line.end());
+        auto edited_ends = chunker.split(edited);
+
+        std::set<std::vector<uint8_t>> chunks;
+        size_t begin = 0;
+        for (auto e : ends) {
+            chunks.emplace(data.begin()+begin, data.begin()+e);
+            begin = e;
+        }
+        size_t changed = 0;
+        begin = 0;
+        for (auto e : edited_ends) {
+            if (not chunks.count({edited.begin()+begin, edited.begin()+e}))
+                ++changed;
+            begin = e;
+        }
+        REQUIRE ( changed <= 2 );
+    }
+}
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
@@ -0,0 +1,107 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <thread>
+
+extern "C" {
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+}
+
+#include "cluster.h"
+
+namespace dpaste {
+namespace tests {
+
+static const constexpr char* LOOPBACK = "127.0.0.1";
+
+Cluster::Cluster(size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        nodes_.emplace_back(std::make_unique<Node>());
+        if (i == 0)
+            nodes_.front()->run(0, "");
+        else
+            nodes_.back()->run(0, LOOPBACK, std::to_string(nodes_.front()->port()));
+    }
+    if (size > 1)
+        wait_connected([this]() {
+            for (const auto& n : nodes_)
+                if (n->peers() == 0)
+                    return false;
+            return true;
+        });
+
+    closed_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (closed_fd_ < 0 or bind(closed_fd_, reinterpret_cast<sockaddr*>(&addr), len) != 0
+            or getsockname(closed_fd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+        throw std::runtime_error("Failed to bind the stand-in proxy socket");
+    closed_port_ = ntohs(addr.sin_port);
+}
+
+Cluster::~Cluster() {
+    for (auto& n : nodes_)
+        n->stop();
+    if (closed_fd_ >= 0)
+        close(closed_fd_);
+}
+
+Cluster& Cluster::shared() {
+    static Cluster cluster;
+    return cluster;
+}
+
+std::string Cluster::bootstrap() const {
+    return std::string {LOOPBACK}+':'+std::to_string(nodes_.front()->port());
+}
+
+void Cluster::join(Node& node) const {
+    node.run(0, LOOPBACK, std::to_string(nodes_.front()->port()));
+    wait_connected([&]() { return node.peers() > 0; });
+}
+
+std::map<std::string, std::string> Cluster::options() const {
+    return {
+        {"bootstrap", bootstrap()},
+        {"host",      LOOPBACK},
+        {"port",      std::to_string(closed_port_)},
+    };
+}
+
+void Cluster::wait_connected(const std::function<bool()>& connected) {
+    using namespace std::literals::chrono_literals;
+    const auto deadline = std::chrono::steady_clock::now()+CONNECT_TIMEOUT;
+    while (not connected()) {
+        if (std::chrono::steady_clock::now() > deadline)
+            throw std::runtime_error("DHT nodes of the cluster failed to connect");
+        std::this_thread::sleep_for(10ms);
+    }
+}
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
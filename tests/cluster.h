@@ -0,0 +1,97 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "node.h"
+
+namespace dpaste {
+namespace tests {
+
+/**
+ * A DHT network of its own on the loopback interface, so that tests and
+ * benchmarks neither depend on nor reach the public network. Nodes are bound to
+ * random ports and bootstrapped to the first one.
+ */
+class Cluster {
+public:
+    static const constexpr size_t DEFAULT_SIZE {4};
+    static const constexpr std::chrono::seconds CONNECT_TIMEOUT {10};
+
+    /**
+     * Start the nodes and wait until each of them knows another one.
+     *
+     * @param size  The number of nodes.
+     *
+     * @throw std::runtime_error if they are not connected within
+     *        CONNECT_TIMEOUT.
+     */
+    explicit Cluster(size_t size = DEFAULT_SIZE);
+    virtual ~Cluster();
+
+    /**
+     * @return a cluster of DEFAULT_SIZE nodes started on first use and shared
+     *         by the callers until exit.
+     */
+    static Cluster& shared();
+
+    size_t size() const { return nodes_.size(); }
+    Node& operator[](size_t i) { return *nodes_[i]; }
+
+    /**
+     * @return the "bootstrap" option (host:port) to join the cluster with.
+     */
+    std::string bootstrap() const;
+
+    /**
+     * Start a node, bootstrap it to the cluster and wait until it is
+     * connected.
+     *
+     * @throw std::runtime_error if it is not connected within CONNECT_TIMEOUT.
+     */
+    void join(Node& node) const;
+
+    /**
+     * @return options for a Bin using the cluster (see Bin::Bin). Its HTTP
+     *         proxy refuses connections, so every request falls back to the
+     *         DHT at once.
+     */
+    std::map<std::string, std::string> options() const;
+
+private:
+    static void wait_connected(const std::function<bool()>& connected);
+
+    std::vector<std::unique_ptr<Node>> nodes_;
+    /* bound but never listening: connections to it are refused */
+    int closed_fd_ {-1};
+    in_port_t closed_port_ {0};
+};
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
@@ -0,0 +1,70 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "tests.h"
+#include "erasure.h"
+
+namespace dpaste {
+namespace tests {
+
+TEST_CASE("ReedSolomon encode/reconstruct", "[ReedSolomon][encode][reconstruct]") {
+    const size_t K = 6, M = 3, LEN = 100;
+    ReedSolomon rs {K, M};
+
+    std::vector<std::vector<uint8_t>> data (K, std::vector<uint8_t>(LEN));
+    for (auto& d : data)
+        for (auto& b : d)
+            b = random_number();
+    auto shards = data;
+    auto parity = rs.encode(data);
+    REQUIRE ( parity.size() == M );
+    shards.insert(shards.end(), parity.begin(), parity.end());
+
+    SECTION ( "nothing missing" ) {
+        REQUIRE ( rs.reconstruct(shards) );
+        REQUIRE ( std::equal(data.begin(), data.end(), shards.begin()) );
+    }
+    SECTION ( "as many data shards missing as there are parity shards" ) {
+        shards[0].clear();
+        shards[3].clear();
+        shards[5].clear();
+        REQUIRE ( rs.reconstruct(shards) );
+        REQUIRE ( std::equal(data.begin(), data.end(), shards.begin()) );
+    }
+    SECTION ( "data and parity shards missing" ) {
+        shards[1].clear();
+        shards[K].clear();
+        shards[K+2].clear();
+        REQUIRE ( rs.reconstruct(shards) );
+        REQUIRE ( std::equal(data.begin(), data.end(), shards.begin()) );
+    }
+    SECTION ( "too many shards missing" ) {
+        for (size_t i = 0; i <= M; ++i)
+            shards[i].clear();
+        REQUIRE ( not rs.reconstruct(shards) );
+    }
+}
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
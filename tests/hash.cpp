@@ -0,0 +1,57 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "hash.h"
+
+namespace dpaste {
+namespace tests {
+
+TEST_CASE("Sha256 digest", "[Sha256][hash][update]") {
+    const std::string ABC = "abc";
+    const std::string ABC_DIGEST = "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+    std::vector<uint8_t> data {ABC.begin(), ABC.end()};
+
+    SECTION ( "one shot" ) {
+        REQUIRE ( crypto::Sha256::toHex(crypto::Sha256::hash(data)) == ABC_DIGEST );
+    }
+    SECTION ( "incremental" ) {
+        crypto::Sha256 h;
+        h.update(data.data(), 1);
+        h.update(data.data()+1, 2);
+        REQUIRE ( crypto::Sha256::toHex(h.digest()) == ABC_DIGEST );
+    }
+}
+
+TEST_CASE("Sha256 hmac", "[Sha256][hmac]") {
+    /* RFC 4231, test case 2 */
+    const std::string KEY = "Jefe";
+    const std::string DATA = "what do ya want for nothing?";
+    std::vector<uint8_t> key {KEY.begin(), KEY.end()};
+    std::vector<uint8_t> data {DATA.begin(), DATA.end()};
+    REQUIRE ( crypto::Sha256::toHex(crypto::Sha256::hmac(key, data.data(), data.size()))
+            == "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843" );
+}
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
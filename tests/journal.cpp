@@ -0,0 +1,107 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <chrono>
+
+extern "C" {
+#include <utime.h>
+#include <sys/stat.h>
+}
+
+#include <catch2/catch.hpp>
+
+#include "tests.h"
+#include "journal.h"
+
+namespace dpaste {
+namespace tests {
+
+TEST_CASE("Journal records survive a new run", "[Journal][load][done][has][set]") {
+    const auto path = Journal::path("test-"+random_pin());
+    const std::vector<uint8_t> code {'c', 'o', 'd', 'e'};
+    const std::vector<uint8_t> part {0, 1, 2, '\n', 3};
+    const auto leaf = crypto::Sha256::hash(part);
+    const auto other = crypto::Sha256::hash(code);
+    {
+        Journal j {path};
+        j.reset();
+        j.set("code", code);
+        j.done(leaf, part);
+    }
+
+    SECTION ( "loading the records" ) {
+        Journal j {path};
+        REQUIRE ( j.load() );
+        REQUIRE ( j.get("code") == code );
+        REQUIRE ( j.has(leaf) );
+        REQUIRE ( j.part(leaf) == part );
+        REQUIRE ( not j.has(other) );
+    }
+    SECTION ( "ignoring a record cut short" ) {
+        {
+            std::ofstream f(path, std::ios::out | std::ios::binary | std::ios::app);
+            f << "done " << crypto::Sha256::toHex(other) << " 100\n" << "abc";
+        }
+        Journal j {path};
+        REQUIRE ( j.load() );
+        REQUIRE ( j.has(leaf) );
+        REQUIRE ( not j.has(other) );
+    }
+    SECTION ( "keeping the records private" ) {
+        struct stat st;
+        REQUIRE ( stat(path.c_str(), &st) == 0 );
+        REQUIRE ( (st.st_mode & 0777) == 0600 );
+    }
+    SECTION ( "starting anew" ) {
+        Journal j {path};
+        j.reset();
+        REQUIRE ( not j.has(leaf) );
+        Journal j2 {path};
+        REQUIRE ( not j2.load() );
+    }
+    Journal {path}.remove();
+    REQUIRE ( not std::ifstream(path).is_open() );
+}
+
+TEST_CASE("Journal pruning of expired journals", "[Journal][prune]") {
+    using namespace std::literals::chrono_literals;
+    const auto stale = Journal::path("get-test-"+random_pin());
+    const auto fresh = Journal::path("paste-test-"+random_pin());
+    for (const auto& path : {stale, fresh}) {
+        Journal j {path};
+        j.reset();
+        j.set("code", {'c'});
+    }
+    const auto past = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()-2h);
+    const utimbuf times {past, past};
+    REQUIRE ( utime(stale.c_str(), &times) == 0 );
+
+    Journal::prune(1h);
+    REQUIRE ( not std::ifstream(stale).is_open() );
+    REQUIRE ( std::ifstream(fresh).is_open() );
+    Journal {fresh}.remove();
+}
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
@@ -0,0 +1,123 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <set>
+
+extern "C" {
+#include <sys/stat.h>
+}
+
+#include <catch2/catch.hpp>
+
+#include "tests.h"
+#include "journal.h"
+#include "keeper.h"
+
+namespace dpaste {
+namespace tests {
+
+TEST_CASE("Keeper hands out every value in turn", "[Keeper][keep][next]") {
+    const auto path = Journal::path("test-kept-"+random_pin());
+    const size_t VALUES {10};
+    {
+        Keeper k {path};
+        for (size_t i = 0; i < VALUES; ++i)
+            k.keep("code"+std::to_string(i), {static_cast<uint8_t>(i), '\n', 0});
+    }
+
+    SECTION ( "reading the values back" ) {
+        Keeper k {path};
+        REQUIRE ( k.size() == VALUES );
+        std::set<std::string> seen;
+        for (size_t round = 0; round < 3; ++round) {
+            auto values = k.next(4);
+            REQUIRE ( values.size() == 4 );
+            for (const auto& v : values) {
+                REQUIRE ( v.second == std::vector<uint8_t> {static_cast<uint8_t>(std::stoi(v.first.substr(4))), '\n', 0} );
+                seen.insert(v.first);
+            }
+        }
+        REQUIRE ( seen.size() == VALUES );
+    }
+    SECTION ( "replacing a value" ) {
+        Keeper k {path};
+        k.keep("code0", {42});
+        REQUIRE ( k.size() == VALUES );
+        auto values = k.next(1);
+        REQUIRE ( values.front().first == "code0" );
+        REQUIRE ( values.front().second == std::vector<uint8_t> {42} );
+    }
+    SECTION ( "keeping the same value again" ) {
+        const auto size = std::ifstream(path, std::ios::in | std::ios::binary | std::ios::ate).tellg();
+        Keeper k {path};
+        k.keep("code0", {0, '\n', 0});
+        REQUIRE ( std::ifstream(path, std::ios::in | std::ios::binary | std::ios::ate).tellg() == size );
+        REQUIRE ( k.size() == VALUES );
+    }
+    SECTION ( "forgetting values" ) {
+        Keeper k {path}, reader {path};
+        REQUIRE ( reader.size() == VALUES );
+        k.keep("code0", {42});
+        REQUIRE ( k.forget({"code0", "code1", "other"}) == 2 );
+        REQUIRE ( k.size() == VALUES-2 );
+        REQUIRE ( k.get("code0").empty() );
+        REQUIRE ( k.get("code2") == std::vector<uint8_t> {2, '\n', 0} );
+        /* the value replaced is gone from the file too */
+        REQUIRE ( std::ifstream(path, std::ios::in | std::ios::binary | std::ios::ate).tellg()
+                == static_cast<std::streamoff>((VALUES-2)*std::string {"keep code2 3\n"}.size()+(VALUES-2)*3) );
+        /* the values are as private as they were */
+        struct stat st;
+        REQUIRE ( stat(path.c_str(), &st) == 0 );
+        REQUIRE ( (st.st_mode & 0777) == 0600 );
+        /* read again from the start by the others */
+        REQUIRE ( reader.size() == VALUES-2 );
+        k.keep("code1", {1});
+        REQUIRE ( reader.get("code1") == std::vector<uint8_t> {1} );
+    }
+    SECTION ( "ignoring a record cut short" ) {
+        {
+            std::ofstream f(path, std::ios::out | std::ios::binary | std::ios::app);
+            f << "keep other 100\n" << "abc";
+        }
+        Keeper k {path};
+        REQUIRE ( k.size() == VALUES );
+        REQUIRE ( k.next(VALUES+1).size() == VALUES );
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Keeper spreads republication evenly", "[Keeper][batch_delay]") {
+    using namespace std::literals::chrono_literals;
+    const std::chrono::milliseconds period {8min};
+
+    /* every value once per period */
+    REQUIRE ( Keeper::batch_delay(1000, 16, period, 50) == period*16/1000 );
+    REQUIRE ( Keeper::batch_delay(4, 16, period, 50) == period );
+    REQUIRE ( Keeper::batch_delay(0, 16, period, 50) == period );
+    /* no faster than the maximum rate */
+    REQUIRE ( Keeper::batch_delay(100000, 16, period, 50) == 320ms );
+}
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
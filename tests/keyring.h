@@ -0,0 +1,94 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+namespace dpaste {
+namespace tests {
+
+/**
+ * Throwaway keyring for GPG pastes: a single key without passphrase, generated
+ * with gpg(1) on first use. The user's keyring is never touched: GNUPGHOME
+ * points to a temporary directory for the whole run.
+ */
+class TestKeyring {
+public:
+    TestKeyring() {
+        if (not mkdtemp(home_.data()))
+            return;
+        setenv("GNUPGHOME", home_.c_str(), 1);
+        if (std::system("gpg --batch --quiet --passphrase '' --quick-gen-key dpaste-test@localhost "
+                        "future-default default never 2>/dev/null") != 0)
+            return;
+
+        std::unique_ptr<FILE, decltype(&pclose)> p {popen("gpg --batch --with-colons --list-keys 2>/dev/null", "r"),
+                                                    pclose};
+        if (not p)
+            return;
+        std::array<char, 512> line;
+        while (std::fgets(line.data(), line.size(), p.get())) {
+            /* fpr:::::::::<fingerprint>: */
+            std::string l {line.data()};
+            if (l.compare(0, 4, "fpr:") == 0) {
+                fpr_ = l.substr(12, l.find(':', 12)-12);
+                break;
+            }
+        }
+    }
+    ~TestKeyring() {
+        std::system(("gpgconf --kill gpg-agent 2>/dev/null; rm -rf "+home_).c_str());
+    }
+
+    /**
+     * @return the fingerprint of the key, or an empty string if it could not
+     *         be generated.
+     */
+    static const std::string& key() {
+        static const TestKeyring keyring;
+        return keyring.fpr_;
+    }
+
+    /**
+     * Set the trust of the key. gpg trusts its own keys ultimately: without
+     * it, the signatures of the key are good but of unknown validity, like
+     * those of a key met on the network and not certified.
+     *
+     * @param ultimate  Whether to trust the key ultimately.
+     */
+    static void trust(bool ultimate) {
+        std::system(("echo '"+key()+":"+(ultimate ? "6" : "2")+":' | gpg --batch --quiet --import-ownertrust "
+                     "2>/dev/null").c_str());
+    }
+
+private:
+    std::string home_ {"/tmp/dpaste-keyring-XXXXXX"};
+    std::string fpr_;
+};
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
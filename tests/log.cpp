@@ -0,0 +1,94 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <thread>
+#include <vector>
+#include <sstream>
+#include <iostream>
+
+#include <catch2/catch.hpp>
+
+#include "tests.h"
+#include "log.h"
+
+namespace dpaste {
+namespace tests {
+
+TEST_CASE("Log formats its records as printf", "[Log][format]") {
+    Log::Record r {};
+    r.format = "%s has %zu values, %d%% %5.1f %c %llu%s";
+    r.add(std::string("abc"));
+    r.add(size_t {3});
+    r.add(-4);
+    r.add(2.5);
+    r.add('x');
+    r.add(static_cast<unsigned long long>(-1));
+    REQUIRE ( Log::format(r) == "abc has 3 values, -4%   2.5 x 18446744073709551615(missing)" );
+
+    SECTION ( "string arguments are truncated" ) {
+        Log::Record t {};
+        t.format = "%s %s";
+        t.add(std::string(2*Log::TEXT_SIZE, 'a'));
+        t.add("b");
+        const auto s = Log::format(t);
+        REQUIRE ( s == std::string(Log::TEXT_SIZE-1, 'a')+' ' );
+    }
+}
+
+TEST_CASE("Log writes or counts every message", "[Log][write][flush]") {
+    REQUIRE ( not Log::enabled(Log::Level::ERROR) );
+    std::ostringstream captured;
+    auto buf = std::cerr.rdbuf(captured.rdbuf());
+    Log::set_level(Log::Level::INFO);
+    DPASTE_LOG_DEBUG("not written %d", 0);
+
+    const size_t THREADS {8}, MESSAGES {1000};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREADS; ++t)
+        threads.emplace_back([t]() {
+            for (size_t i = 0; i < MESSAGES; ++i)
+                DPASTE_LOG_WARN("thread %zu message %zu", t, i);
+        });
+    for (auto& t : threads)
+        t.join();
+    Log::flush();
+    Log::set_level(Log::Level::OFF);
+    std::cerr.rdbuf(buf);
+
+    std::istringstream lines(captured.str());
+    size_t written {0}, dropped {0};
+    for (std::string line; std::getline(lines, line);) {
+        REQUIRE ( line.find("not written") == std::string::npos );
+        if (line.find("DPASTE: warning: thread ") == 0)
+            ++written;
+        else {
+            const auto p = line.find("[[");
+            REQUIRE ( p != std::string::npos );
+            dropped += std::stoul(line.substr(p+2));
+        }
+    }
+    REQUIRE ( written > 0 );
+    REQUIRE ( written+dropped == THREADS*MESSAGES );
+}
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
@@ -0,0 +1,63 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "merkle.h"
+
+namespace dpaste {
+namespace tests {
+
+TEST_CASE("Merkle root over leaves", "[Merkle][root][leaf]") {
+    using crypto::Merkle;
+    std::vector<Merkle::Digest> leaves;
+    for (uint8_t i = 0; i < 5; ++i)
+        leaves.emplace_back(Merkle::leaf({i, i, i}));
+
+    SECTION ( "leaf and node hashes are distinct from plain hashes" ) {
+        REQUIRE ( Merkle::leaf({1, 2, 3}) != crypto::Sha256::hash({1, 2, 3}) );
+    }
+    SECTION ( "single leaf is the root" ) {
+        REQUIRE ( Merkle::root({leaves.front()}) == leaves.front() );
+    }
+    SECTION ( "two leaves" ) {
+        crypto::Sha256 h;
+        const uint8_t node_prefix = 0x01;
+        h.update(&node_prefix, 1);
+        h.update(leaves[0].data(), leaves[0].size());
+        h.update(leaves[1].data(), leaves[1].size());
+        REQUIRE ( Merkle::root({leaves[0], leaves[1]}) == h.digest() );
+    }
+    SECTION ( "odd number of leaves" ) {
+        auto r5 = Merkle::root(leaves);
+        auto r4 = Merkle::root({leaves.begin(), leaves.begin()+4});
+        REQUIRE ( Merkle::root({r4, leaves[4]}) == r5 );
+    }
+    SECTION ( "any change in a leaf changes the root" ) {
+        auto r = Merkle::root(leaves);
+        leaves[2] = Merkle::leaf({2, 2});
+        REQUIRE ( Merkle::root(leaves) != r );
+    }
+}
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
@@ -0,0 +1,104 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <sstream>
+
+#include <catch2/catch.hpp>
+
+#include "tests.h"
+#include "metrics.h"
+
+namespace dpaste {
+namespace tests {
+
+TEST_CASE("Metrics histogram buckets", "[Metrics][bucket]") {
+    REQUIRE ( Metrics::bucket(0) == 0 );
+    REQUIRE ( Metrics::bucket(1024) == 0 );
+    for (size_t b = 0; b+1 < Metrics::BUCKETS; ++b) {
+        const auto bound = Metrics::bucket_bound(b);
+        REQUIRE ( Metrics::bucket(bound) == b );
+        REQUIRE ( Metrics::bucket(bound+1) == b+1 );
+        if (b)
+            REQUIRE ( bound > Metrics::bucket_bound(b-1) );
+    }
+    REQUIRE ( Metrics::bucket(UINT64_MAX) == Metrics::BUCKETS-1 );
+}
+
+TEST_CASE("Metrics add up every thread", "[Metrics][counter][histogram][snapshot]") {
+    using namespace std::literals::chrono_literals;
+    const auto& c = Metrics::counter("test_events_total", "Test events.", "kind=\"a\"");
+    REQUIRE ( &c == &Metrics::counter("test_events_total", "Ignored.", "kind=\"a\"") );
+    const auto& h = Metrics::histogram("test_seconds", "Test durations.");
+
+    const size_t THREADS {8}, EVENTS {10000};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREADS; ++t)
+        threads.emplace_back([&]() {
+            for (size_t i = 0; i < EVENTS; ++i)
+                c.add();
+            h.observe(2ms);
+        });
+    /* a thread which is still running */
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool recorded {false}, done {false};
+    std::thread running([&]() {
+        c.add(5);
+        std::unique_lock<std::mutex> lk(mtx);
+        recorded = true;
+        cv.notify_all();
+        cv.wait(lk, [&]() { return done; });
+    });
+    for (auto& t : threads)
+        t.join();
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk, [&]() { return recorded; });
+    }
+
+    std::ostringstream out;
+    Metrics::snapshot(out);
+    const auto s = out.str();
+    REQUIRE ( s.find("# HELP test_events_total Test events.\n") != std::string::npos );
+    REQUIRE ( s.find("# TYPE test_events_total counter\n") != std::string::npos );
+    REQUIRE ( s.find("test_events_total{kind=\"a\"} "+std::to_string(THREADS*EVENTS+5)+"\n") != std::string::npos );
+    REQUIRE ( s.find("# TYPE test_seconds histogram\n") != std::string::npos );
+    REQUIRE ( s.find("test_seconds_bucket{le=\"0.001835008\"} 0\n") != std::string::npos );
+    REQUIRE ( s.find("test_seconds_bucket{le=\"0.002097152\"} "+std::to_string(THREADS)+"\n") != std::string::npos );
+    REQUIRE ( s.find("test_seconds_bucket{le=\"+Inf\"} "+std::to_string(THREADS)+"\n") != std::string::npos );
+    REQUIRE ( s.find("test_seconds_sum 0.016\n") != std::string::npos );
+    REQUIRE ( s.find("test_seconds_count "+std::to_string(THREADS)+"\n") != std::string::npos );
+
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        done = true;
+    }
+    cv.notify_all();
+    running.join();
+}
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
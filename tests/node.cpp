@@ -18,9 +18,15 @@
  * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
+#include <sstream>
+#include <mutex>
+#include <condition_variable>
+
 #include <catch2/catch.hpp>
 
 #include "tests.h"
+#include "cluster.h"
 #include "node.h"
 
 namespace dpaste {
@@ -41,7 +47,7 @@ TEST_CASE("Node get/paste on DHT", "[Node][get][paste]") {
     const std::string PIN = random_pin();
     std::vector<uint8_t> data = {0, 1, 2, 3, 4};
     dpaste::Node node {};
-    node.run();
+    Cluster::shared().join(node);
 
     SECTION ( "pasting data {0,1,2,3,4}" ) {
         REQUIRE ( node.paste(PIN, std::vector<uint8_t> {data}) );
@@ -50,12 +56,90 @@ TEST_CASE("Node get/paste on DHT", "[Node][get][paste]") {
             auto rd = node.get(PIN);
             REQUIRE ( data == rd.front() );
         }
+        SECTION ( "getting the first acceptable blob" ) {
+            std::vector<uint8_t> other = {5, 6, 7};
+            REQUIRE ( node.paste(PIN, std::vector<uint8_t> {other}) );
+            size_t examined {0};
+            auto rd = node.get(PIN, [&](const dht::Blob& b) { return b == other; }, &examined);
+            REQUIRE ( rd == other );
+            REQUIRE ( examined >= 1 );
+            REQUIRE ( node.get(PIN, [](const dht::Blob&) { return false; }, &examined).empty() );
+            REQUIRE ( examined == 2 );
+        }
+        SECTION ( "pasting the same blob again refreshes it" ) {
+            REQUIRE ( node.paste(PIN, std::vector<uint8_t> {data}) );
+            REQUIRE ( node.get(PIN).size() == 1 );
+        }
     }
 
     node.stop();
     REQUIRE ( not pt.is_running(node) );
 }
 
+TEST_CASE("Node listen on a loopback cluster", "[Node][listen][paste]") {
+    using namespace std::literals::chrono_literals;
+    const std::string PIN = random_pin();
+    std::vector<uint8_t> data = {0, 1, 2, 3, 4};
+
+    Cluster cluster {2};
+    auto& first = cluster[0];
+    auto& second = cluster[1];
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<dht::Blob> received;
+    auto token = second.listen(PIN, [&](const dht::Blob& b) {
+        std::lock_guard<std::mutex> lk(mtx);
+        received.emplace_back(b);
+        cv.notify_all();
+        return true;
+    });
+
+    SECTION ( "a blob pasted on one node is announced to the other" ) {
+        REQUIRE ( first.paste(PIN, std::vector<uint8_t> {data}) );
+        std::unique_lock<std::mutex> lk(mtx);
+        REQUIRE ( cv.wait_for(lk, 10s, [&]() { return not received.empty(); }) );
+        REQUIRE ( received.front() == data );
+    }
+
+    second.cancel_listen(PIN, token);
+}
+
+TEST_CASE("Node replicated pastes spread gets over a loopback cluster", "[Node][replicas][get][paste]") {
+    const std::string PIN = random_pin();
+    const unsigned REPLICAS {4};
+    const unsigned NODES {6};
+    const unsigned GETS {64};
+    std::vector<uint8_t> data = {0, 1, 2, 3, 4};
+
+    Cluster nodes {NODES};
+    REQUIRE ( nodes[0].paste(PIN, std::vector<uint8_t> {data}, REPLICAS) );
+
+    /* load generator: every node but the first gets the paste in turn */
+    std::vector<unsigned> served (REPLICAS);
+    for (unsigned i = 0; i < GETS; ++i) {
+        unsigned replica {REPLICAS};
+        auto rd = nodes[1+i%(NODES-1)].get(PIN, {}, nullptr, REPLICAS, &replica);
+        REQUIRE ( rd == data );
+        REQUIRE ( replica < REPLICAS );
+        ++served[replica];
+    }
+    std::ostringstream distribution;
+    for (unsigned r = 0; r < REPLICAS; ++r)
+        distribution << "replica " << r << " served " << served[r] << " of " << GETS << " gets" << std::endl;
+    unsigned storing {0};
+    for (unsigned i = 0; i < NODES; ++i) {
+        distribution << "node " << i << " stores " << nodes[i].stored() << " values" << std::endl;
+        storing += nodes[i].stored() > 0;
+    }
+    INFO ( distribution.str() );
+    for (unsigned r = 0; r < REPLICAS; ++r) {
+        CHECK ( served[r] > 0 );
+        CHECK ( served[r] < GETS/2 );
+    }
+    CHECK ( storing > 1 );
+}
+
 } /* tests */
 } /* dpaste */
 
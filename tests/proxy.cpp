@@ -0,0 +1,285 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <future>
+#include <sstream>
+#include <stdexcept>
+
+extern "C" {
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+}
+
+#include <b64/encode.h>
+#include <opendht/value.h>
+#include <opendht/infohash.h>
+
+#include "proxy.h"
+#include "node.h"
+
+namespace dpaste {
+namespace tests {
+
+static const constexpr char* HEADERS_END = "\r\n\r\n";
+
+static bool send_all(int fd, const std::string& s) {
+    size_t sent {0};
+    while (sent < s.size()) {
+        auto n = send(fd, s.data()+sent, s.size()-sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+/* value of a header (lower case name), or an empty string */
+static std::string header(const std::string& headers, const std::string& name) {
+    std::string lower {headers};
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    auto pos = lower.find("\r\n"+name+':');
+    if (pos == std::string::npos)
+        return {};
+    pos += name.size()+3;
+    auto end = lower.find("\r\n", pos);
+    auto value = headers.substr(pos, end-pos);
+    value.erase(0, value.find_first_not_of(' '));
+    return value;
+}
+
+/* field of a multipart/form-data body */
+static std::string form_field(const std::string& content_type, const std::string& body, const std::string& name) {
+    const std::string key {"boundary="};
+    auto b = content_type.find(key);
+    if (b == std::string::npos)
+        return {};
+    const auto delimiter = "\r\n--"+content_type.substr(b+key.size());
+    auto pos = body.find("name=\""+name+'"');
+    if (pos == std::string::npos)
+        return {};
+    pos = body.find(HEADERS_END, pos);
+    if (pos == std::string::npos)
+        return {};
+    pos += 4;
+    auto end = body.find(delimiter, pos);
+    return body.substr(pos, end == std::string::npos ? end : end-pos);
+}
+
+static std::string status_line(int status) {
+    return "HTTP/1.1 "+std::to_string(status)+(status == 200 ? " OK" : " Error")+"\r\n";
+}
+
+Proxy::Proxy() {
+    start();
+}
+
+Proxy::Proxy(const std::string& bootstrap) : dht_(std::make_unique<dht::DhtRunner>()) {
+    dht_->run(0, dht::crypto::generateIdentity(), true);
+    dht_->registerType(dht::ValueType {Node::DPASTE_VALUE_TYPE, Node::DPASTE_USER_TYPE, Node::VALUE_EXPIRATION});
+    const auto colon = bootstrap.rfind(':');
+    dht_->bootstrap(bootstrap.substr(0, colon), bootstrap.substr(colon+1));
+    start();
+}
+
+void Proxy::start() {
+    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (fd_ < 0 or bind(fd_, reinterpret_cast<sockaddr*>(&addr), len) != 0 or listen(fd_, SOMAXCONN) != 0
+            or getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        if (fd_ >= 0)
+            close(fd_);
+        throw std::runtime_error("Failed to bind the proxy socket");
+    }
+    port_ = ntohs(addr.sin_port);
+    acceptor_ = std::thread([this]() { serve(); });
+}
+
+Proxy::~Proxy() {
+    {
+        std::unique_lock<std::mutex> lk(mtx_);
+        stopping_ = true;
+        /* wakes up accept() and the connections being read from */
+        shutdown(fd_, SHUT_RDWR);
+        for (auto fd : open_)
+            shutdown(fd, SHUT_RDWR);
+        cv_.notify_all();
+    }
+    acceptor_.join();
+    close(fd_);
+    {
+        std::unique_lock<std::mutex> lk(mtx_);
+        cv_.wait(lk, [this]() { return open_.empty(); });
+    }
+    if (dht_)
+        dht_->join();
+}
+
+void Proxy::set_faults(const Faults& faults) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    faults_ = faults;
+    cv_.notify_all();
+}
+
+void Proxy::serve() {
+    for (;;) {
+        auto fd = accept(fd_, nullptr, nullptr);
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (stopping_) {
+            if (fd >= 0)
+                close(fd);
+            return;
+        }
+        if (fd < 0)
+            continue;
+        /* connections are detached, the destructor waits for open_ to be empty */
+        open_.push_back(fd);
+        std::thread([this, fd]() {
+            handle(fd);
+            std::lock_guard<std::mutex> lk(mtx_);
+            open_.erase(std::find(open_.begin(), open_.end(), fd));
+            close(fd);
+            cv_.notify_all();
+        }).detach();
+    }
+}
+
+void Proxy::handle(int fd) {
+    std::string request;
+    std::array<char, 16*1024> buf;
+    size_t headers_end;
+    while ((headers_end = request.find(HEADERS_END)) == std::string::npos) {
+        auto n = recv(fd, buf.data(), buf.size(), 0);
+        if (n <= 0)
+            return;
+        request.append(buf.data(), n);
+    }
+    const auto headers = request.substr(0, headers_end+2);
+    auto body = request.substr(headers_end+4);
+
+    std::istringstream request_line {headers};
+    std::string method, target;
+    request_line >> method >> target;
+    if (method == "GET")
+        ++gets_;
+    else
+        ++puts_;
+
+    const auto content_length = header(headers, "content-length");
+    const size_t length = content_length.empty() ? 0 : std::stoul(content_length);
+    if (body.size() < length and header(headers, "expect") == "100-continue"
+            and not send_all(fd, "HTTP/1.1 100 Continue\r\n\r\n"))
+        return;
+    while (body.size() < length) {
+        auto n = recv(fd, buf.data(), buf.size(), 0);
+        if (n <= 0)
+            return;
+        body.append(buf.data(), n);
+    }
+
+    Faults faults;
+    {
+        std::unique_lock<std::mutex> lk(mtx_);
+        cv_.wait(lk, [this]() { return stopping_ or not faults_.stall; });
+        faults = faults_;
+        if (faults.stall or cv_.wait_for(lk, faults.latency, [this]() { return stopping_; }))
+            return;
+    }
+
+    if (faults.status != 200) {
+        send_all(fd, status_line(faults.status)+"Content-Length: 0\r\nConnection: close\r\n\r\n");
+        return;
+    }
+    auto response = respond(method, target, headers, body);
+    if (faults.truncate) {
+        const auto end = response.find(HEADERS_END)+4;
+        response.resize(end+(response.size()-end)/2);
+    }
+    send_all(fd, response);
+}
+
+std::string Proxy::respond(const std::string& method, const std::string& target, const std::string& headers,
+                           const std::string& body)
+{
+    const auto hash = target.substr(1, target.find('?')-1);
+    std::string content {"{}"};
+    if (method == "GET") {
+        content = "[";
+        const auto values = load(hash);
+        for (size_t i = 0; i < values.size(); ++i) {
+            std::istringstream iss {values[i]};
+            std::ostringstream b64;
+            base64::encoder e;
+            e.encode(iss, b64);
+            /* libb64 wraps lines, which JSON strings may not hold */
+            auto encoded = b64.str();
+            encoded.erase(std::remove(encoded.begin(), encoded.end(), '\n'), encoded.end());
+            content += (i ? ",{\"id\":\"" : "{\"id\":\"")+std::to_string(i)+"\",\"base64\":\""+encoded+"\"}";
+        }
+        content += "]";
+    } else {
+        if (not store(hash, form_field(header(headers, "content-type"), body, "data")))
+            return status_line(500)+"Content-Length: 0\r\nConnection: close\r\n\r\n";
+    }
+    return status_line(200)+"Content-Type: application/json\r\nContent-Length: "+std::to_string(content.size())
+        +"\r\nConnection: close\r\n\r\n"+content;
+}
+
+bool Proxy::store(const std::string& hash, std::string&& data) {
+    if (not dht_) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        values_[hash].emplace_back(std::move(data));
+        ++stored_;
+        return true;
+    }
+    auto v = std::make_shared<dht::Value>(dht::Blob {data.begin(), data.end()});
+    v->user_type = Node::DPASTE_USER_TYPE;
+    v->type = Node::DPASTE_VALUE_TYPE;
+    std::promise<bool> done;
+    auto stored = done.get_future();
+    dht_->put(dht::InfoHash {hash}, v, [&](bool success) { done.set_value(success); });
+    if (not stored.get())
+        return false;
+    ++stored_;
+    return true;
+}
+
+std::vector<std::string> Proxy::load(const std::string& hash) {
+    if (not dht_) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return values_[hash];
+    }
+    std::vector<std::string> values;
+    for (const auto& v : dht_->get(dht::InfoHash {hash}, dht::Value::AllFilter(),
+                                   dht::Where{}.userType(Node::DPASTE_USER_TYPE)).get())
+        values.emplace_back(v->data.begin(), v->data.end());
+    return values;
+}
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
@@ -0,0 +1,131 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <netinet/in.h>
+}
+
+#include <opendht/dhtrunner.h>
+
+namespace dpaste {
+namespace tests {
+
+/**
+ * Stand-in for OpenDHT's HTTP proxy on the loopback interface. It serves what
+ * HttpClient asks for: `GET /<hash>?user_type=` answers the values stored
+ * under the hash as JSON, and a form `POST /<hash>` stores its "data" field.
+ * Values are held in memory or on the DHT. Faults can be injected to see how
+ * Bin falls back to the DHT.
+ *
+ * Every request is served on a connection of its own, which is closed after
+ * the response.
+ */
+class Proxy {
+public:
+    struct Faults {
+        /* delay before responding */
+        std::chrono::milliseconds latency {0};
+        /* status of the responses; with any other than 200, the body is empty */
+        int status {200};
+        /* the connection is closed halfway through the body */
+        bool truncate {false};
+        /* requests are held until the stall is lifted, then served, or until
+         * the proxy is destroyed */
+        bool stall {false};
+    };
+
+    /**
+     * Bind to a random loopback port and start serving values held in memory.
+     *
+     * @throw std::runtime_error if the socket cannot be bound.
+     */
+    Proxy();
+    /**
+     * Serve values from a DHT node of its own, like OpenDHT's proxy does.
+     *
+     * @param bootstrap  The node to bootstrap to (host:port), e.g.
+     *                   Cluster::bootstrap().
+     */
+    explicit Proxy(const std::string& bootstrap);
+    virtual ~Proxy();
+
+    in_port_t port() const { return port_; }
+
+    /**
+     * Set the faults of the requests to come and of those stalled.
+     */
+    void set_faults(const Faults& faults);
+
+    /**
+     * @return the number of requests received so far.
+     */
+    size_t gets() const { return gets_; }
+    size_t puts() const { return puts_; }
+
+    /**
+     * @return the number of values stored so far.
+     */
+    size_t stored() const { return stored_; }
+
+private:
+    void start();
+    void serve();
+    void handle(int fd);
+    /* response to a request, without faults */
+    std::string respond(const std::string& method, const std::string& target, const std::string& headers,
+                        const std::string& body);
+    bool store(const std::string& hash, std::string&& data);
+    std::vector<std::string> load(const std::string& hash);
+
+    int fd_ {-1};
+    in_port_t port_ {0};
+    std::thread acceptor_ {};
+
+    mutable std::mutex mtx_ {};
+    std::condition_variable cv_ {};
+    bool stopping_ {false};
+    Faults faults_ {};
+    /* values by hash (hexadecimal), unless on the DHT */
+    std::map<std::string, std::vector<std::string>> values_ {};
+    std::unique_ptr<dht::DhtRunner> dht_ {};
+    /* connections being served and their sockets */
+    std::vector<int> open_ {};
+
+    std::atomic<size_t> gets_ {0};
+    std::atomic<size_t> puts_ {0};
+    std::atomic<size_t> stored_ {0};
+};
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
@@ -0,0 +1,96 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <thread>
+#include <sstream>
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include <nlohmann/json.hpp>
+
+#include "tests.h"
+#include "stats.h"
+
+namespace dpaste {
+namespace tests {
+
+TEST_CASE("Stats add up the spans of each stage", "[Stats][Span][report]") {
+    using namespace std::literals::chrono_literals;
+    const auto stage = [](const std::string& name) {
+        for (const auto& s : Stats::stages())
+            if (s.name == name)
+                return s;
+        return Stats::Stage {};
+    };
+    {
+        Stats::Span span {"test disabled", 1};
+    }
+    REQUIRE ( stage("test disabled").calls == 0 );
+
+    Stats::enable();
+    for (int i = 0; i < 2; ++i) {
+        Stats::Span span {"test sleep", 10};
+        std::this_thread::sleep_for(5ms);
+        span.bytes_out(20);
+    }
+    auto s = stage("test sleep");
+    REQUIRE ( s.calls == 2 );
+    REQUIRE ( s.wall >= 10ms );
+    REQUIRE ( s.cpu < s.wall );
+    REQUIRE ( s.bytes_in == 20 );
+    REQUIRE ( s.bytes_out == 40 );
+
+    SECTION ( "allocations" ) {
+        /* kept so that the allocation is not elided */
+        static std::vector<std::vector<uint8_t>> kept;
+        {
+            Stats::Span span {"test alloc"};
+            kept.emplace_back(1000);
+        }
+        REQUIRE ( Alloc::enabled() );
+        REQUIRE ( stage("test alloc").allocs >= 1 );
+        REQUIRE ( stage("test alloc").alloc_bytes >= 1000 );
+    }
+    SECTION ( "table report" ) {
+        std::ostringstream out;
+        Stats::report(out);
+        REQUIRE ( out.str().find("test sleep") != std::string::npos );
+        REQUIRE ( out.str().find("total") != std::string::npos );
+    }
+    SECTION ( "JSON report" ) {
+        std::ostringstream out;
+        Stats::report(out, true);
+        auto j = nlohmann::json::parse(out.str());
+        bool found {false};
+        for (const auto& st : j["stages"])
+            if (st["name"].get<std::string>() == "test sleep") {
+                found = true;
+                REQUIRE ( st["calls"].get<uint64_t>() >= 2 );
+                REQUIRE ( st["bytes_out"].get<uint64_t>() >= 40 );
+            }
+        REQUIRE ( found );
+        REQUIRE ( j["wall_ms"].get<double>() >= 10 );
+    }
+}
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/
@@ -19,8 +19,16 @@
  */
 
 #include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
 
-#define CATCH_CONFIG_MAIN
+extern "C" {
+#include <ftw.h>
+#include <sys/stat.h>
+}
+
+#define CATCH_CONFIG_RUNNER
 #include <catch2/catch.hpp>
 
 namespace dpaste {
@@ -54,5 +62,31 @@ std::string random_pin() {
 } /* tests */
 } /* dpaste */
 
+/*
+ * The tests write journals, kept values and queued pastes, and Bin::flush
+ * publishes every paste of the spool: they are run with data, cache and
+ * configuration directories of their own, removed afterwards, so that those of
+ * the user are left alone.
+ */
+int main(int argc, char* argv[]) {
+    char dir[] = "/tmp/dpaste-tests-XXXXXX";
+    if (not mkdtemp(dir)) {
+        std::cerr << "Can't create a directory for the tests." << std::endl;
+        return 1;
+    }
+    for (const auto& xdg : {std::make_pair("XDG_DATA_HOME", "/data"), std::make_pair("XDG_CACHE_HOME", "/cache"),
+                            std::make_pair("XDG_CONFIG_HOME", "/config")}) {
+        const auto path = std::string {dir}+xdg.second;
+        mkdir(path.c_str(), 0700);
+        setenv(xdg.first, path.c_str(), 1);
+    }
+
+    const auto rc = Catch::Session().run(argc, argv);
+
+    nftw(dir, [](const char* path, const struct stat*, int, struct FTW*) { return std::remove(path); }, 16,
+         FTW_DEPTH | FTW_PHYS);
+    return rc;
+}
+
 /* vim: set ts=4 sw=4 tw=120 et :*/
 
@@ -0,0 +1,88 @@
+/*
+ * Copyright © 2026 Simon Désaulniers
+ * Author: Simon Désaulniers <sim.desaulniers@gmail.com>
+ *
+ * This file is part of dpaste.
+ *
+ * dpaste is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dpaste is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dpaste.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <map>
+
+#include <catch2/catch.hpp>
+#include <nlohmann/json.hpp>
+
+#include "tests.h"
+#include "journal.h"
+#include "trace.h"
+
+namespace dpaste {
+namespace tests {
+
+TEST_CASE("Trace writes matching events per thread", "[Trace][Scope][stop]") {
+    const auto path = Journal::path("test-trace-"+random_pin());
+    {
+        Trace::Scope scope {"before", "test"};
+    }
+    Trace::start(path);
+    int op;
+    {
+        Trace::Scope scope {"outer", "test", 42};
+        Trace::async_begin("op", "test", reinterpret_cast<uintptr_t>(&op));
+        std::thread t([&]() {
+            Trace::name_thread("worker");
+            Trace::Scope scope {"inner", "test"};
+            Trace::async_end("op", "test", reinterpret_cast<uintptr_t>(&op));
+        });
+        t.join();
+    }
+    REQUIRE ( Trace::stop() );
+    REQUIRE ( not Trace::enabled() );
+
+    std::ifstream f(path);
+    const auto trace = nlohmann::json::parse(f);
+    std::remove(path.c_str());
+
+    std::map<std::string, int> depth;
+    std::map<std::string, std::string> threads;
+    std::map<std::string, uint64_t> tids;
+    for (const auto& e : trace["traceEvents"]) {
+        const auto ph = e["ph"].get<std::string>();
+        const auto name = e["name"].get<std::string>();
+        REQUIRE ( name != "before" );
+        if (ph == "M")
+            threads[e["args"]["name"].get<std::string>()] = e["tid"].dump();
+        else if (ph == "B" or ph == "b")
+            ++depth[name];
+        else if (ph == "E" or ph == "e")
+            REQUIRE ( --depth[name] >= 0 );
+        if (ph == "B" and name == "outer")
+            REQUIRE ( e["args"]["bytes"].get<uint64_t>() == 42 );
+        if (ph == "B")
+            tids[name] = e["tid"].get<uint64_t>();
+    }
+    for (const auto& d : depth)
+        REQUIRE ( d.second == 0 );
+    REQUIRE ( depth.size() == 3 );
+    REQUIRE ( threads.size() == 2 );
+    REQUIRE ( tids["outer"] != tids["inner"] );
+}
+
+} /* tests */
+} /* dpaste */
+
+/* vim: set ts=4 sw=4 tw=120 et :*/